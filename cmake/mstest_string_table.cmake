@@ -0,0 +1,65 @@
+# String table for the binary result format. Lists suite and test names
+# and source files of a test target, so mstest_decode can resolve the
+# hashes sent by --format=binary:
+#   test <suite> <testcase>
+#   file <path as passed to the compiler>
+#
+# Usage: mstest_add_string_table(<target>), writes <target>.strings next
+# to the target. Included in script mode it generates the table itself.
+# Test macros are those test_macros.hpp defines with (fixture, testcase).
+
+if (CMAKE_SCRIPT_MODE_FILE)
+    file(READ ${MACROS} macros)
+    string(REGEX MATCHALL "#define MSTEST[A-Z_]*\\(fixture, testcase\\)" definitions "${macros}")
+    set(names "")
+    foreach (definition ${definitions})
+        string(REGEX REPLACE "^#define (MSTEST[A-Z_]*).*$" "\\1" name "${definition}")
+        if (NOT name MATCHES "^MSTEST_DETAIL_")
+            list(APPEND names ${name})
+        endif ()
+    endforeach ()
+    string(REPLACE ";" "|" names "${names}")
+
+    string(REPLACE "|" ";" sources "${SOURCES}")
+    set(table "")
+    foreach (source ${sources})
+        string(APPEND table "file ${source}\n")
+        file(READ ${source} content)
+        string(REGEX MATCHALL "(${names})[ \t]*\\([ \t]*[A-Za-z_][A-Za-z0-9_]*[ \t]*,[ \t]*[A-Za-z_][A-Za-z0-9_]*[ \t]*\\)" tests "${content}")
+        foreach (test ${tests})
+            string(REGEX REPLACE "^[^(]*\\([ \t]*([A-Za-z0-9_]+)[ \t]*,[ \t]*([A-Za-z0-9_]+).*$" "test \\1 \\2\n" test "${test}")
+            string(APPEND table "${test}")
+        endforeach ()
+    endforeach ()
+    file(WRITE ${OUTPUT} "${table}")
+    return()
+endif ()
+
+set(MSTEST_STRING_TABLE_SCRIPT ${CMAKE_CURRENT_LIST_FILE} CACHE INTERNAL "Generator of mstest string tables")
+set(MSTEST_TEST_MACROS ${CMAKE_CURRENT_LIST_DIR}/../include/mstest/test_macros.hpp CACHE INTERNAL "Header defining the mstest test macros")
+
+function(mstest_add_string_table target)
+    get_target_property(sources ${target} SOURCES)
+    get_target_property(source_dir ${target} SOURCE_DIR)
+
+    set(absolute_sources "")
+    foreach (source ${sources})
+        if (NOT source MATCHES "\\$<")
+            get_filename_component(source ${source} ABSOLUTE BASE_DIR ${source_dir})
+            list(APPEND absolute_sources ${source})
+        endif ()
+    endforeach ()
+    string(REPLACE ";" "|" source_argument "${absolute_sources}")
+
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}.strings)
+    add_custom_command(
+        OUTPUT ${output}
+        COMMAND ${CMAKE_COMMAND} -DOUTPUT=${output} -DSOURCES=${source_argument} -DMACROS=${MSTEST_TEST_MACROS}
+            -P ${MSTEST_STRING_TABLE_SCRIPT}
+        DEPENDS ${absolute_sources} ${MSTEST_STRING_TABLE_SCRIPT} ${MSTEST_TEST_MACROS}
+        COMMENT "Generating string table of ${target}"
+        VERBATIM
+    )
+    add_custom_target(${target}_strings ALL DEPENDS ${output})
+    add_dependencies(${target} ${target}_strings)
+endfunction()
@@ -0,0 +1,130 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "mstest/detail/failure_record.hpp"
+#include "mstest/detail/test_result.hpp"
+#include "mstest/expectations.hpp"
+
+/* Blocks of a test remembered until it frees them, a power of two. Only
+ * frees of remembered blocks count, so freeing a block from before the
+ * test cannot hide a leak. Past three quarters of the table blocks are
+ * merely counted and any unknown free is taken as one of them. */
+#ifndef MSTEST_ALLOCATION_BLOCKS
+#if defined(MSTEST_HOST)
+#define MSTEST_ALLOCATION_BLOCKS 1024
+#else
+#define MSTEST_ALLOCATION_BLOCKS 64
+#endif
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+#if defined(MSTEST_ALLOCATION_TRACKING)
+/* Heap counters of the calling thread, they only move between
+ * start_allocation_tracking() and stop_allocation_tracking(). Blocks are
+ * remembered for owner, nullptr forgets those of earlier owners: stretches
+ * of a test interleaved with others pass the same owner each time. */
+const AllocationStats& thread_allocations();
+void start_allocation_tracking(const void* owner = nullptr);
+AllocationStats stop_allocation_tracking();
+#else
+inline const AllocationStats& thread_allocations()
+{
+    static const AllocationStats none;
+    return none;
+}
+
+inline void start_allocation_tracking(const void* = nullptr)
+{
+}
+
+inline AllocationStats stop_allocation_tracking()
+{
+    return AllocationStats{};
+}
+#endif
+
+} // namespace detail
+
+/* Fails the current test when the scope it lives in allocates more blocks
+ * than allowed. Never fails without MSTEST_ALLOCATION_TRACKING. */
+class AllocationGuard
+{
+public:
+    AllocationGuard(detail::Expectation kind, std::uint32_t limit, const std::source_location& location)
+        : kind_(kind)
+        , limit_(limit)
+        , start_(detail::thread_allocations().allocations)
+        , location_(location)
+    {
+    }
+
+    ~AllocationGuard()
+    {
+        const std::uint32_t allocations = detail::thread_allocations().allocations - start_;
+        if (kind_ == detail::Expectation::no_allocations)
+        {
+            generic_matcher(allocations == 0, kind_, location_, allocations);
+        }
+        else
+        {
+            generic_matcher(allocations <= limit_, kind_, location_, limit_, allocations);
+        }
+    }
+
+    AllocationGuard(const AllocationGuard&) = delete;
+    AllocationGuard& operator=(const AllocationGuard&) = delete;
+
+private:
+    detail::Expectation kind_;
+    std::uint32_t limit_;
+    std::uint32_t start_;
+    std::source_location location_;
+};
+
+/*
+ *   {
+ *       const auto guard = mstest::expect_no_allocations();
+ *       hot_path();
+ *   }
+ */
+[[nodiscard]] inline AllocationGuard expect_no_allocations(const std::source_location& location = std::source_location::current())
+{
+    return AllocationGuard(detail::Expectation::no_allocations, 0, location);
+}
+
+[[nodiscard]] inline AllocationGuard expect_max_allocations(std::uint32_t limit,
+    const std::source_location& location = std::source_location::current())
+{
+    return AllocationGuard(detail::Expectation::max_allocations, limit, location);
+}
+
+} // namespace mstest
@@ -0,0 +1,582 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+
+#include "mstest/detail/context.hpp"
+#include "mstest/expectations.hpp"
+#include "mstest/test.hpp"
+
+/* Virtual time the scheduler may reach, tests still waiting by then fail */
+#ifndef MSTEST_ASYNC_TIME_LIMIT_NS
+#define MSTEST_ASYNC_TIME_LIMIT_NS 3600000000000ull
+#endif
+
+namespace mstest
+{
+
+class Event;
+class Task;
+
+namespace detail
+{
+
+class TaskPromise;
+class TestCaseNode;
+class WaitList;
+
+/* Suspended coroutine queued in the scheduler. Lives in the awaiter or the
+ * promise that suspended, destroying the coroutine unlinks it. */
+struct Waiter
+{
+    Waiter() = default;
+    Waiter(const Waiter&) = delete;
+    Waiter& operator=(const Waiter&) = delete;
+    ~Waiter();
+
+    TaskPromise* task = nullptr;
+    /* Set while waiting for an event */
+    const Event* event = nullptr;
+    /* Virtual time a timer expires at */
+    std::uint64_t deadline = 0;
+    /* Where it waits, reported when it never resumes */
+    const char* file = nullptr;
+    std::uint_least32_t line = 0;
+    WaitList* list = nullptr;
+    Waiter* previous = nullptr;
+    Waiter* next = nullptr;
+};
+
+/* Intrusive list of waiters, nothing is allocated to queue a coroutine */
+class WaitList
+{
+public:
+    Waiter* front() const
+    {
+        return head_;
+    }
+
+    void push_back(Waiter& waiter)
+    {
+        insert(waiter, nullptr);
+    }
+
+    /* Links waiter in front of position, at the end for nullptr */
+    void insert(Waiter& waiter, Waiter* position)
+    {
+        waiter.list = this;
+        waiter.next = position;
+        waiter.previous = position != nullptr ? position->previous : tail_;
+        (waiter.previous != nullptr ? waiter.previous->next : head_) = &waiter;
+        (position != nullptr ? position->previous : tail_) = &waiter;
+    }
+
+    void remove(Waiter& waiter)
+    {
+        (waiter.previous != nullptr ? waiter.previous->next : head_) = waiter.next;
+        (waiter.next != nullptr ? waiter.next->previous : tail_) = waiter.previous;
+        waiter.list = nullptr;
+        waiter.previous = nullptr;
+        waiter.next = nullptr;
+    }
+
+private:
+    Waiter* head_ = nullptr;
+    Waiter* tail_ = nullptr;
+};
+
+inline Waiter::~Waiter()
+{
+    if (list != nullptr)
+    {
+        list->remove(*this);
+    }
+}
+
+/* Body of a test run by the scheduler */
+struct AsyncTest
+{
+    mstest::Test* test = nullptr;
+    /* Where its expectations go, nullptr for the record of the context */
+    TestRecord* record = nullptr;
+    /* Set when it runs in a group, see run_async_group() */
+    TestCaseNode* node = nullptr;
+    TaskPromise* root = nullptr;
+    /* Tasks started with spawn(), they end together with the root */
+    TaskPromise* spawned = nullptr;
+    /* Time spent running its coroutines */
+    std::uint64_t execute_ns = 0;
+    AllocationStats heap;
+    /* Hardware events while its coroutines ran, counted in a group only */
+    CounterStats counters;
+};
+
+/* Single threaded cooperative scheduler with a virtual clock. Coroutines
+ * run until they wait, when nothing is ready the clock jumps straight to
+ * the next timer, so waiting costs no real time. One per runner thread. */
+class Scheduler
+{
+public:
+    static Scheduler& get()
+    {
+        static MSTEST_THREAD_LOCAL Scheduler scheduler;
+        return scheduler;
+    }
+
+    /* Runs the roots of tests, the clock starts at zero. Returns once every
+     * root finished, ended with an assert_* or can never finish, which
+     * fails its test. grouped tells the tests were set up by
+     * run_async_group(), which has the scheduler track each of them. */
+    void run(AsyncTest* tests, std::size_t count, bool grouped);
+
+    std::uint64_t now() const
+    {
+        return now_;
+    }
+
+    void ready(Waiter& waiter)
+    {
+        ready_.push_back(waiter);
+    }
+
+    void sleep(Waiter& waiter);
+    void wait(Waiter& waiter)
+    {
+        waiting_.push_back(waiter);
+    }
+
+    /* Makes everything waiting for event ready */
+    void wake(const Event& event);
+
+    /* Starts task next to the running one, it belongs to the same test */
+    void spawn(TaskPromise& task);
+
+    /* Coroutine that runs now, symmetric transfers bypass resume() */
+    void running(TaskPromise* task)
+    {
+        running_ = task;
+    }
+
+    /* Task without a parent reached its end */
+    void finished(TaskPromise& task)
+    {
+        finished_ = &task;
+    }
+
+private:
+    Scheduler() = default;
+
+    void resume(Waiter& waiter);
+    void enter(AsyncTest& test);
+    void leave(AsyncTest& test);
+    void end_root(AsyncTest& test);
+    void end_spawned(AsyncTest& test);
+    void fail(AsyncTest& test, Expectation kind);
+
+    WaitList ready_;
+    /* Sorted by deadline, equal ones in the order they were added */
+    WaitList timers_;
+    WaitList waiting_;
+    std::uint64_t now_ = 0;
+    std::size_t pending_ = 0;
+    bool grouped_ = false;
+    TaskPromise* running_ = nullptr;
+    TaskPromise* finished_ = nullptr;
+};
+
+inline void suspend_in(Waiter& waiter, TaskPromise& task);
+
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<TaskPromise> finishing) noexcept;
+
+    void await_resume() const noexcept
+    {
+    }
+};
+
+/* A stopped coroutine, left in the middle by an assert_*, cannot be
+ * destroyed through its handle, its frame is freed directly. That is
+ * only right for frames operator new allocated: one the compiler placed
+ * in the frame of its caller is freed along with it. */
+class TaskPromise
+{
+public:
+    TaskPromise()
+    {
+        start.task = this;
+        /* A frame allocation is last seen right before its promise is
+         * constructed, a frame without one never shares its address */
+        if (std::coroutine_handle<TaskPromise>::from_promise(*this).address() == allocated_frame_)
+        {
+            frame_size_ = allocated_size_;
+        }
+        allocated_frame_ = nullptr;
+    }
+
+    static void* operator new(std::size_t size)
+    {
+        allocated_frame_ = ::operator new(size);
+        allocated_size_ = size;
+        return allocated_frame_;
+    }
+
+    static void operator delete(void* frame, std::size_t size)
+    {
+        ::operator delete(frame, size);
+    }
+
+    Task get_return_object() noexcept;
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void return_void() const noexcept
+    {
+    }
+
+    void unhandled_exception() const noexcept
+    {
+        std::terminate();
+    }
+
+    /* Destroys the coroutine, a stopped one is only freed, its locals are
+     * not destroyed */
+    void destroy()
+    {
+        if (!stopped)
+        {
+            std::coroutine_handle<TaskPromise>::from_promise(*this).destroy();
+            return;
+        }
+        const std::size_t size = frame_size_;
+        if (size != 0)
+        {
+            operator delete(std::coroutine_handle<TaskPromise>::from_promise(*this).address(), size);
+        }
+    }
+
+    AsyncTest* owner = nullptr;
+    /* Awaits this task */
+    TaskPromise* parent = nullptr;
+    /* Awaited by this task */
+    TaskPromise* child = nullptr;
+    /* What it waits for while suspended in an event or a timer */
+    Waiter* waiting = nullptr;
+    /* Queues the task when it starts without a parent */
+    Waiter start;
+    /* Siblings in AsyncTest::spawned */
+    TaskPromise* previous_spawned = nullptr;
+    TaskPromise* next_spawned = nullptr;
+    /* Left in the middle by an assert_*, it can never be resumed */
+    bool stopped = false;
+
+private:
+    static inline MSTEST_THREAD_LOCAL void* allocated_frame_ = nullptr;
+    static inline MSTEST_THREAD_LOCAL std::size_t allocated_size_ = 0;
+
+    /* Size of the frame operator new allocated, 0 when it was elided */
+    std::size_t frame_size_ = 0;
+};
+
+inline void suspend_in(Waiter& waiter, TaskPromise& task)
+{
+    waiter.task = &task;
+    task.waiting = &waiter;
+}
+
+inline std::coroutine_handle<> FinalAwaiter::await_suspend(std::coroutine_handle<TaskPromise> finishing) noexcept
+{
+    TaskPromise& task = finishing.promise();
+    Scheduler& scheduler = Scheduler::get();
+    if (task.parent == nullptr)
+    {
+        scheduler.finished(task);
+        return std::noop_coroutine();
+    }
+    scheduler.running(task.parent);
+    return std::coroutine_handle<TaskPromise>::from_promise(*task.parent);
+}
+
+/* Starts the awaited task right away and resumes the awaiting one when
+ * it is done, without going through the scheduler */
+struct TaskAwaiter
+{
+    TaskPromise* task;
+
+    bool await_ready() const noexcept
+    {
+        return task == nullptr;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<TaskPromise> awaiting) noexcept
+    {
+        TaskPromise& parent = awaiting.promise();
+        task->owner = parent.owner;
+        task->parent = &parent;
+        parent.child = task;
+        Scheduler::get().running(task);
+        return std::coroutine_handle<TaskPromise>::from_promise(*task);
+    }
+
+    void await_resume() const noexcept
+    {
+        if (task != nullptr)
+        {
+            task->parent->child = nullptr;
+        }
+    }
+};
+
+class SleepAwaiter
+{
+public:
+    SleepAwaiter(std::uint64_t deadline, const std::source_location& location)
+    {
+        waiter_.deadline = deadline;
+        waiter_.file = location.file_name();
+        waiter_.line = location.line();
+    }
+
+    bool await_ready() const noexcept
+    {
+        return waiter_.deadline <= Scheduler::get().now();
+    }
+
+    void await_suspend(std::coroutine_handle<TaskPromise> awaiting) noexcept
+    {
+        suspend_in(waiter_, awaiting.promise());
+        Scheduler::get().sleep(waiter_);
+    }
+
+    void await_resume() const noexcept
+    {
+        if (waiter_.task != nullptr)
+        {
+            waiter_.task->waiting = nullptr;
+        }
+    }
+
+private:
+    Waiter waiter_;
+};
+
+class YieldAwaiter
+{
+public:
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<TaskPromise> awaiting) noexcept
+    {
+        waiter_.task = &awaiting.promise();
+        Scheduler::get().ready(waiter_);
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    Waiter waiter_;
+};
+
+/* Runs body on the scheduler of the calling thread, called by the
+ * execute() of an MSTEST_ASYNC test running on its own */
+void run_async(Task body);
+
+} // namespace detail
+
+/* Return type of MSTEST_ASYNC bodies and of the coroutines they co_await.
+ * A task does not run until it is awaited or spawned. */
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise;
+
+    Task(Task&& other) noexcept
+        : promise_(std::exchange(other.promise_, nullptr))
+    {
+    }
+
+    Task& operator=(Task&& other) = delete;
+
+    ~Task()
+    {
+        if (promise_ != nullptr)
+        {
+            promise_->destroy();
+        }
+    }
+
+    detail::TaskAwaiter operator co_await() && noexcept
+    {
+        return detail::TaskAwaiter{promise_};
+    }
+
+    /* Hands the coroutine over to the caller */
+    detail::TaskPromise* release() noexcept
+    {
+        return std::exchange(promise_, nullptr);
+    }
+
+private:
+    friend class detail::TaskPromise;
+
+    explicit Task(detail::TaskPromise* promise)
+        : promise_(promise)
+    {
+    }
+
+    detail::TaskPromise* promise_;
+};
+
+inline Task detail::TaskPromise::get_return_object() noexcept
+{
+    return Task(this);
+}
+
+/* Flag coroutines wait for until it is set, it stays set until reset().
+ * Async tests of one suite running together may share an event to signal
+ * each other. Only usable from the thread the tests run on. */
+class Event
+{
+public:
+    class Awaiter
+    {
+    public:
+        Awaiter(const Event& event, const std::source_location& location)
+            : event_(event)
+        {
+            waiter_.event = &event;
+            waiter_.file = location.file_name();
+            waiter_.line = location.line();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return event_.set_;
+        }
+
+        void await_suspend(std::coroutine_handle<detail::TaskPromise> awaiting) noexcept
+        {
+            detail::suspend_in(waiter_, awaiting.promise());
+            detail::Scheduler::get().wait(waiter_);
+        }
+
+        void await_resume() const noexcept
+        {
+            if (waiter_.task != nullptr)
+            {
+                waiter_.task->waiting = nullptr;
+            }
+        }
+
+    private:
+        const Event& event_;
+        detail::Waiter waiter_;
+    };
+
+    /* Makes every waiting coroutine ready, they run once the caller waits */
+    void set()
+    {
+        set_ = true;
+        detail::Scheduler::get().wake(*this);
+    }
+
+    void reset()
+    {
+        set_ = false;
+    }
+
+    bool is_set() const
+    {
+        return set_;
+    }
+
+    /*
+     *   co_await interrupt.wait();
+     */
+    Awaiter wait(const std::source_location& location = std::source_location::current()) const
+    {
+        return Awaiter(*this, location);
+    }
+
+private:
+    bool set_ = false;
+};
+
+/* Virtual time of the running tests in nanoseconds, starts at zero */
+inline std::uint64_t virtual_now()
+{
+    return detail::Scheduler::get().now();
+}
+
+/* Suspends until the virtual clock reaches deadline_ns */
+inline detail::SleepAwaiter sleep_until(std::uint64_t deadline_ns,
+    const std::source_location& location = std::source_location::current())
+{
+    return detail::SleepAwaiter(deadline_ns, location);
+}
+
+inline detail::SleepAwaiter sleep_for(std::uint64_t ns, const std::source_location& location = std::source_location::current())
+{
+    return detail::SleepAwaiter(virtual_now() + ns, location);
+}
+
+/* Lets every other ready coroutine run first */
+inline detail::YieldAwaiter yield()
+{
+    return {};
+}
+
+/* Runs task next to the calling coroutine, e.g. as a simulated interrupt
+ * source. It belongs to the running test and is destroyed once the body of
+ * that test is done, even if it did not finish. */
+inline void spawn(Task task)
+{
+    detail::Scheduler::get().spawn(*task.release());
+}
+
+} // namespace mstest
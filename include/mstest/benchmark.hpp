@@ -0,0 +1,132 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "mstest/detail/clock.hpp"
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/test_result.hpp"
+
+/* Timed batches per benchmark, each one produces a sample */
+#ifndef MSTEST_BENCH_SAMPLES
+#define MSTEST_BENCH_SAMPLES 50
+#endif
+
+/* Batch size is calibrated until a batch takes at least that long */
+#ifndef MSTEST_BENCH_SAMPLE_NS
+#define MSTEST_BENCH_SAMPLE_NS 1000000
+#endif
+
+namespace mstest
+{
+
+/* Forces value to be computed and kept, without generating any code */
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <class T>
+inline void do_not_optimize(T& value)
+{
+    if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*))
+    {
+        asm volatile("" : "+r"(value) : : "memory");
+    }
+    else
+    {
+        asm volatile("" : "+m"(value) : : "memory");
+    }
+}
+
+/* Makes the compiler assume all memory was read and written */
+inline void clobber()
+{
+    asm volatile("" : : : "memory");
+}
+
+namespace detail
+{
+
+template <class Body>
+std::uint64_t time_batch(Body& body, std::uint64_t iterations)
+{
+    const std::uint64_t start = Clock::now();
+    for (std::uint64_t i = 0; i < iterations; ++i)
+    {
+        body();
+    }
+    return Clock::to_ns(Clock::now() - start);
+}
+
+/* Runs body in batches sized to take MSTEST_BENCH_SAMPLE_NS and stores
+ * per iteration statistics in the context of the current test */
+template <class Body>
+void run_benchmark(Body body)
+{
+    constexpr std::uint64_t target_ns = MSTEST_BENCH_SAMPLE_NS;
+    std::uint64_t batch = 1;
+    for (;;)
+    {
+        const std::uint64_t elapsed = time_batch(body, batch);
+        if (elapsed >= target_ns || batch >= (std::uint64_t(1) << 40))
+        {
+            break;
+        }
+        std::uint64_t scale = 10;
+        if (elapsed > target_ns / 10)
+        {
+            scale = target_ns * 12 / 10 / elapsed + 1;
+        }
+        batch *= scale;
+    }
+
+    double samples[MSTEST_BENCH_SAMPLES];
+    double sum = 0;
+    for (double& sample : samples)
+    {
+        sample = static_cast<double>(time_batch(body, batch)) / static_cast<double>(batch);
+        sum += sample;
+    }
+    std::sort(samples, samples + MSTEST_BENCH_SAMPLES);
+
+    constexpr std::size_t count = MSTEST_BENCH_SAMPLES;
+    BenchmarkStats stats;
+    stats.iterations = batch * count;
+    stats.samples = count;
+    stats.min_ns = samples[0];
+    stats.median_ns = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    stats.p99_ns = samples[(count * 99 + 99) / 100 - 1];
+    stats.mean_ns = sum / count;
+    Context::get().benchmark(stats);
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,117 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Compact result stream for slow links (UART, semihosting).
+ *
+ * The stream starts with the magic bytes, followed by frames:
+ *   type (1 byte), payload size (varint), payload
+ *
+ * Integers in payloads are unsigned LEB128 varints, names are sent as
+ * FNV-1a hashes (see hash.hpp) resolved by the decoder from a string table
+ * generated at build time. Raw operand bytes are little endian.
+ *
+ * Nothing else may be written to the stream once it started: the decoder
+ * rejects unknown frame types, so new ones need a new version in magic. */
+
+namespace mstest
+{
+namespace detail
+{
+namespace binary
+{
+
+constexpr std::uint8_t magic[] = {'M', 'S', 'T', 0x01};
+
+enum class Frame : std::uint8_t
+{
+    /* test count */
+    start = 1,
+    /* suite id */
+    suite,
+    /* test id, file id, line, kind, operand count,
+     * then per operand: type, size, bytes */
+    failure,
+    /* test id, iterations, samples, min, median, p99, mean in picoseconds */
+    benchmark,
+    /* test id, NUL terminated title, text until the end of the payload */
+    note,
+    /* test id, flags, budget ms, setup ns, execute ns, teardown ns,
+     * allocations, frees, allocated bytes, peak bytes, live bytes,
+     * available counters, then one count per CounterEvent */
+    result,
+    /* executed, passed, skipped */
+    summary,
+    /* test id, number of failures not recorded */
+    dropped,
+    /* test id, seed, cases, shrinks, duration ns, falsified,
+     * counterexample text until the end of the payload */
+    property,
+    /* test id, runs, failures, p50 ns, p99 ns, max ns */
+    repeat
+};
+
+enum ResultFlags : std::uint8_t
+{
+    passed = 1,
+    timed_out = 2
+};
+
+/* Longest encoding of a 64-bit varint */
+constexpr std::size_t max_varint_size = 10;
+
+inline std::size_t put_varint(std::uint8_t* out, std::uint64_t value)
+{
+    std::size_t size = 0;
+    while (value >= 0x80)
+    {
+        out[size++] = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<std::uint8_t>(value);
+    return size;
+}
+
+inline bool get_varint(const std::uint8_t*& in, const std::uint8_t* end, std::uint64_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; in != end && shift < 64; shift += 7)
+    {
+        const std::uint8_t byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace binary
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,198 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#define MSTEST_HAS_CLOCK_GETTIME 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MSTEST_HAS_TSC 1
+#endif
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define MSTEST_HAS_DWT 1
+#endif
+
+#if !defined(MSTEST_HAS_CLOCK_GETTIME) && !defined(MSTEST_HAS_DWT)
+#include <chrono>
+#endif
+
+/* Clocks measure in ticks of their own and convert differences to
+ * nanoseconds. Define MSTEST_CLOCK to one of the clocks below, or a type
+ * with the same interface, to override the platform default. */
+
+namespace mstest
+{
+namespace clock
+{
+
+#if defined(MSTEST_HAS_CLOCK_GETTIME)
+struct Monotonic
+{
+    static std::uint64_t now()
+    {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000u + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+
+    static std::uint64_t to_ns(std::uint64_t ticks)
+    {
+        return ticks;
+    }
+};
+#endif
+
+#if defined(MSTEST_HAS_TSC) && defined(MSTEST_HAS_CLOCK_GETTIME)
+/* Time stamp counter, scaled by a one time calibration against Monotonic.
+ * Requires an invariant TSC, which all current x86 cores have. */
+struct Tsc
+{
+    static std::uint64_t now()
+    {
+        _mm_lfence();
+        const std::uint64_t ticks = __rdtsc();
+        _mm_lfence();
+        return ticks;
+    }
+
+    static std::uint64_t to_ns(std::uint64_t ticks)
+    {
+        static const double ns_per_tick = calibrate();
+        return static_cast<std::uint64_t>(static_cast<double>(ticks) * ns_per_tick);
+    }
+
+private:
+    static double calibrate()
+    {
+        const std::uint64_t start_ns = Monotonic::now();
+        const std::uint64_t start_ticks = now();
+        while (Monotonic::now() - start_ns < 10000000u)
+        {
+        }
+        const std::uint64_t elapsed_ticks = now() - start_ticks;
+        const std::uint64_t elapsed_ns = Monotonic::now() - start_ns;
+        return static_cast<double>(elapsed_ns) / static_cast<double>(elapsed_ticks);
+    }
+};
+#endif
+
+#if defined(MSTEST_HAS_DWT)
+#if !defined(MSTEST_CPU_FREQUENCY_HZ)
+extern "C" std::uint32_t SystemCoreClock;
+#define MSTEST_CPU_FREQUENCY_HZ SystemCoreClock
+#endif
+
+/* Cortex-M DWT cycle counter. The 32-bit counter is extended to 64 bits,
+ * which holds as long as now() is called at least once per wrap
+ * (about 25 s at 168 MHz). */
+struct Dwt
+{
+    static std::uint64_t now()
+    {
+        static bool enabled = false;
+        static std::uint32_t last = 0;
+        static std::uint64_t high = 0;
+        if (!enabled)
+        {
+            demcr() |= trcena;
+            cyccnt() = 0;
+            dwt_ctrl() |= cyccntena;
+            enabled = true;
+        }
+        const std::uint32_t cycles = cyccnt();
+        if (cycles < last)
+        {
+            high += std::uint64_t(1) << 32;
+        }
+        last = cycles;
+        return high | cycles;
+    }
+
+    static std::uint64_t to_ns(std::uint64_t ticks)
+    {
+        return ticks * 1000u / (static_cast<std::uint64_t>(MSTEST_CPU_FREQUENCY_HZ) / 1000000u);
+    }
+
+private:
+    static constexpr std::uint32_t trcena = 1u << 24;
+    static constexpr std::uint32_t cyccntena = 1u;
+
+    static volatile std::uint32_t& demcr()
+    {
+        return *reinterpret_cast<volatile std::uint32_t*>(0xE000EDFC);
+    }
+
+    static volatile std::uint32_t& dwt_ctrl()
+    {
+        return *reinterpret_cast<volatile std::uint32_t*>(0xE0001000);
+    }
+
+    static volatile std::uint32_t& cyccnt()
+    {
+        return *reinterpret_cast<volatile std::uint32_t*>(0xE0001004);
+    }
+};
+#endif
+
+#if !defined(MSTEST_HAS_CLOCK_GETTIME) && !defined(MSTEST_HAS_DWT)
+struct Steady
+{
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static std::uint64_t to_ns(std::uint64_t ticks)
+    {
+        return ticks;
+    }
+};
+#endif
+
+} // namespace clock
+
+#if !defined(MSTEST_CLOCK)
+#if defined(MSTEST_HAS_CLOCK_GETTIME)
+#define MSTEST_CLOCK mstest::clock::Monotonic
+#elif defined(MSTEST_HAS_DWT)
+#define MSTEST_CLOCK mstest::clock::Dwt
+#else
+#define MSTEST_CLOCK mstest::clock::Steady
+#endif
+#endif
+
+namespace detail
+{
+using Clock = MSTEST_CLOCK;
+} // namespace detail
+
+} // namespace mstest
@@ -0,0 +1,159 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <csetjmp>
+
+#include "mstest/detail/failure_record.hpp"
+#include "mstest/detail/test_result.hpp"
+#include "mstest/test.hpp"
+
+#if defined(MSTEST_HOST)
+#define MSTEST_THREAD_LOCAL thread_local
+#else
+#define MSTEST_THREAD_LOCAL
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Everything a test recorded while it ran, handed to reporters after it
+ * finished. Plain data, so runners can copy it between threads and send
+ * it from a forked worker. */
+struct TestRecord
+{
+    FailureArena failures;
+    BenchmarkStats benchmark;
+    PropertyStats property;
+    RepeatStats repeat;
+
+    bool empty() const
+    {
+        return failures.size() == 0 && failures.dropped() == 0 && benchmark.iterations == 0 && property.cases == 0 && repeat.runs == 0;
+    }
+};
+
+/* Execution state of the test running on the calling thread.
+ * Every runner thread owns its own context, so expectations always
+ * report to the test that is executing them. */
+class Context
+{
+public:
+    static Context& get()
+    {
+        static MSTEST_THREAD_LOCAL Context context;
+        return context;
+    }
+
+    void current_test(Test* test)
+    {
+        current_test_ = test;
+    }
+
+    Test* current_test()
+    {
+        return current_test_;
+    }
+
+    /* Where a failed assert_* jumps to, nullptr when nothing can catch it.
+     * Returns the previous target, restore it to nest escapes. */
+    std::jmp_buf* escape(std::jmp_buf* target)
+    {
+        std::jmp_buf* const previous = escape_;
+        escape_ = target;
+        return previous;
+    }
+
+    std::jmp_buf* escape() const
+    {
+        return escape_;
+    }
+
+    FailureArena& failures()
+    {
+        return record_->failures;
+    }
+
+    void benchmark(const BenchmarkStats& stats)
+    {
+        record_->benchmark = stats;
+    }
+
+    /* Statistics of the benchmark run by the current test, if any */
+    const BenchmarkStats& benchmark() const
+    {
+        return record_->benchmark;
+    }
+
+    void property(const PropertyStats& stats)
+    {
+        record_->property = stats;
+    }
+
+    void repeat(const RepeatStats& stats)
+    {
+        record_->repeat = stats;
+    }
+
+    const TestRecord& record() const
+    {
+        return *record_;
+    }
+
+    /* Replaces everything recorded so far, e.g. with a copy kept from an
+     * earlier run */
+    void record(const TestRecord& record)
+    {
+        *record_ = record;
+    }
+
+    /* Sends everything recorded to record instead, so tests interleaved on
+     * one thread keep their records apart. nullptr returns to the own one. */
+    void redirect(TestRecord* record)
+    {
+        record_ = record != nullptr ? record : &own_record_;
+    }
+
+    /* Forgets everything recorded for the previous test */
+    void reset()
+    {
+        record_->failures.clear();
+        record_->benchmark = BenchmarkStats{};
+        record_->property = PropertyStats{};
+        record_->repeat = RepeatStats{};
+    }
+
+private:
+    Context() = default;
+    Test* current_test_ = nullptr;
+    std::jmp_buf* escape_ = nullptr;
+    TestRecord own_record_;
+    TestRecord* record_ = &own_record_;
+};
+
+} // namespace detail
+} // namespace mstest
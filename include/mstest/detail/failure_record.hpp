@@ -0,0 +1,381 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "mstest/printer.hpp"
+
+/* Failures recorded per test, later ones are only counted */
+#ifndef MSTEST_MAX_FAILURE_RECORDS
+#define MSTEST_MAX_FAILURE_RECORDS 8
+#endif
+
+/* Bytes stored per operand, larger values are formatted immediately and
+ * the text is truncated to this size */
+#ifndef MSTEST_OPERAND_SIZE
+#define MSTEST_OPERAND_SIZE 32
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+enum class Expectation : std::uint8_t
+{
+    generic,
+    is_true,
+    is_false,
+    eq,
+    gt,
+    lt,
+    ge,
+    le,
+    no_allocations,
+    max_allocations,
+    assert_true,
+    assert_false,
+    assert_eq,
+    assert_gt,
+    assert_lt,
+    assert_ge,
+    assert_le,
+    async_deadlock,
+    async_time_limit,
+    buffers_eq,
+    all_near,
+    all_near_ulp,
+    buffer_sizes,
+    buffer_element,
+    mock_calls,
+    mock_called,
+    mock_argument,
+    mock_call_missing
+};
+
+/* Text of the failed call and the names of its operands */
+struct ExpectationInfo
+{
+    const char* call;
+    const char* operands[2];
+};
+
+inline const ExpectationInfo& describe(Expectation kind)
+{
+    static constexpr ExpectationInfo infos[] = {
+        {nullptr, {nullptr, nullptr}},
+        {"expect_true(x)", {"x", nullptr}},
+        {"expect_false(x)", {"x", nullptr}},
+        {"expect_eq(a, b)", {"a", "b"}},
+        {"expect_gt(a, b)", {"a", "b"}},
+        {"expect_lt(a, b)", {"a", "b"}},
+        {"expect_ge(a, b)", {"a", "b"}},
+        {"expect_le(a, b)", {"a", "b"}},
+        {"expect_no_allocations()", {"allocations", nullptr}},
+        {"expect_max_allocations(limit)", {"limit", "allocations"}},
+        {"assert_true(x)", {"x", nullptr}},
+        {"assert_false(x)", {"x", nullptr}},
+        {"assert_eq(a, b)", {"a", "b"}},
+        {"assert_gt(a, b)", {"a", "b"}},
+        {"assert_lt(a, b)", {"a", "b"}},
+        {"assert_ge(a, b)", {"a", "b"}},
+        {"assert_le(a, b)", {"a", "b"}},
+        {"co_await never resumes, nothing left to run could wake it", {nullptr, nullptr}},
+        {"co_await still waiting at the virtual time limit", {"limit_ns", nullptr}},
+        {"expect_buffers_eq(a, b)", {"mismatches", "largest"}},
+        {"expect_all_near(a, b, abs, rel)", {"mismatches", "largest"}},
+        {"expect_all_near_ulp(a, b, ulp)", {"mismatches", "largest"}},
+        {"buffers differ in size", {"a.size()", "b.size()"}},
+        {"element differs", {"a[i]", "b[i]"}},
+        {"expect_calls(count)", {"count", "calls"}},
+        {"expect_called()", {"calls", nullptr}},
+        {"expect_call(i, arguments)", {"actual", "expected"}},
+        {"expect_call(i, arguments) on a call not recorded", {"i", "recorded calls"}},
+    };
+    return infos[static_cast<std::size_t>(kind)];
+}
+
+using PrintFunction = void (*)(const void* data, char* buffer, std::size_t size);
+
+/* How data of an operand is encoded, lets a host tool print raw values
+ * sent by a target. Custom types, including enums that may have their own
+ * Printer, are sent as text. */
+enum class OperandType : std::uint8_t
+{
+    text,
+    boolean,
+    signed_integer,
+    unsigned_integer,
+    floating,
+    pointer,
+    custom
+};
+
+struct OperandRecord
+{
+    PrintFunction print;
+    OperandType type;
+    std::uint8_t size;
+    alignas(std::max_align_t) unsigned char data[MSTEST_OPERAND_SIZE];
+};
+
+struct FailureRecord
+{
+    const char* file;
+    std::uint_least32_t line;
+    Expectation kind;
+    std::uint8_t operand_count;
+    OperandRecord operands[2];
+};
+
+inline void print_text(const void* data, char* buffer, std::size_t size)
+{
+    snprintf(buffer, size, "%s", static_cast<const char*>(data));
+}
+
+template <class T>
+void print_stored(const void* data, char* buffer, std::size_t size)
+{
+    Printer<T>::print(*static_cast<const T*>(data), buffer, size);
+}
+
+/* Writes e.g. "expect_eq(a, b), where a = 1, b = 2", empty for failures
+ * without a known call */
+inline void format_failure(const FailureRecord& failure, char* buffer, std::size_t size)
+{
+    buffer[0] = '\0';
+    const ExpectationInfo& info = describe(failure.kind);
+    if (info.call == nullptr)
+    {
+        return;
+    }
+
+    std::size_t used = static_cast<std::size_t>(snprintf(buffer, size, "%s", info.call));
+    for (std::size_t i = 0; i < failure.operand_count && used < size; ++i)
+    {
+        char value[MSTEST_OPERAND_SIZE * 2];
+        failure.operands[i].print(failure.operands[i].data, value, sizeof(value));
+        used += static_cast<std::size_t>(snprintf(buffer + used, size - used, "%s %s = %s", i == 0 ? ", where" : ",", info.operands[i], value));
+    }
+}
+
+template <class T>
+constexpr OperandType operand_type()
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        return OperandType::boolean;
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        return std::is_signed_v<T> ? OperandType::signed_integer : OperandType::unsigned_integer;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return OperandType::floating;
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        return OperandType::pointer;
+    }
+    else
+    {
+        return OperandType::custom;
+    }
+}
+
+/* Operands copied into the record and printed once the test finished,
+ * others are formatted right when they fail */
+template <class T>
+constexpr bool stored_by_value()
+{
+    return std::is_trivially_copyable_v<T> && sizeof(T) <= MSTEST_OPERAND_SIZE && alignof(T) <= alignof(std::max_align_t)
+        && printer_defers<T>::value;
+}
+
+template <class T>
+void store_operand(OperandRecord& operand, const T& value)
+{
+    if constexpr (stored_by_value<T>())
+    {
+        new (operand.data) T(value);
+        operand.print = &print_stored<T>;
+        operand.type = operand_type<T>();
+        operand.size = sizeof(T);
+    }
+    else
+    {
+        Printer<T>::print(value, reinterpret_cast<char*>(operand.data), sizeof(operand.data));
+        operand.print = &print_text;
+        operand.type = OperandType::text;
+        operand.size = static_cast<std::uint8_t>(strlen(reinterpret_cast<const char*>(operand.data)));
+    }
+}
+
+/* Everything store_operand() knows about a type at compile time. One
+ * constant per operand type, shared by all expectations using it. */
+struct OperandDescriptor
+{
+    PrintFunction print;
+    OperandType type;
+    /* Bytes copied into the record, 0 when formatted right away */
+    std::uint8_t size;
+};
+
+template <class T>
+inline constexpr OperandDescriptor operand_descriptor = {&print_stored<T>, operand_type<T>(),
+    static_cast<std::uint8_t>(stored_by_value<T>() ? sizeof(T) : 0)};
+
+/* Operand of a failed expectation with its type erased */
+struct OperandReference
+{
+    const void* data;
+    const OperandDescriptor* descriptor;
+};
+
+inline void store_operand(OperandRecord& operand, const OperandReference& reference)
+{
+    const OperandDescriptor& descriptor = *reference.descriptor;
+    if (descriptor.size != 0)
+    {
+        memcpy(operand.data, reference.data, descriptor.size);
+        operand.print = descriptor.print;
+        operand.type = descriptor.type;
+        operand.size = descriptor.size;
+    }
+    else
+    {
+        descriptor.print(reference.data, reinterpret_cast<char*>(operand.data), sizeof(operand.data));
+        operand.print = &print_text;
+        operand.type = OperandType::text;
+        operand.size = static_cast<std::uint8_t>(strlen(reinterpret_cast<const char*>(operand.data)));
+    }
+}
+
+/* Preallocated storage for failures of the running test. Recording never
+ * allocates or formats, messages are produced by the runner after the test
+ * body returned. */
+class FailureArena
+{
+public:
+    template <class... Operands>
+    void record(Expectation kind, const char* file, std::uint_least32_t line, const Operands&... operands)
+    {
+        static_assert(sizeof...(Operands) <= 2, "Failure records hold up to two operands");
+        if (size_ == MSTEST_MAX_FAILURE_RECORDS)
+        {
+            ++dropped_;
+            return;
+        }
+        FailureRecord& failure = records_[size_++];
+        failure.file = file;
+        failure.line = line;
+        failure.kind = kind;
+        failure.operand_count = sizeof...(Operands);
+        [[maybe_unused]] std::size_t index = 0;
+        (store_operand(failure.operands[index++], operands), ...);
+    }
+
+    /* Same as record(), with operands described at run time */
+    void record(Expectation kind, const char* file, std::uint_least32_t line, const OperandReference* operands, std::size_t count)
+    {
+        if (size_ == MSTEST_MAX_FAILURE_RECORDS)
+        {
+            ++dropped_;
+            return;
+        }
+        FailureRecord& failure = records_[size_++];
+        failure.file = file;
+        failure.line = line;
+        failure.kind = kind;
+        failure.operand_count = static_cast<std::uint8_t>(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            store_operand(failure.operands[i], operands[i]);
+        }
+    }
+
+    /* Adds an already built record, e.g. one received from a worker */
+    void push(const FailureRecord& failure)
+    {
+        if (size_ == MSTEST_MAX_FAILURE_RECORDS)
+        {
+            ++dropped_;
+            return;
+        }
+        records_[size_++] = failure;
+    }
+
+    void dropped(std::size_t count)
+    {
+        dropped_ = count;
+    }
+
+    void clear()
+    {
+        size_ = 0;
+        dropped_ = 0;
+    }
+
+    /* Forgets failures recorded after size() and dropped() returned these */
+    void rewind(std::size_t size, std::size_t dropped)
+    {
+        size_ = size;
+        dropped_ = dropped;
+    }
+
+    const FailureRecord* begin() const
+    {
+        return records_;
+    }
+
+    const FailureRecord* end() const
+    {
+        return records_ + size_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    std::size_t dropped() const
+    {
+        return dropped_;
+    }
+
+private:
+    FailureRecord records_[MSTEST_MAX_FAILURE_RECORDS];
+    std::size_t size_ = 0;
+    std::size_t dropped_ = 0;
+};
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,51 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace mstest
+{
+namespace detail
+{
+
+/* 32-bit FNV-1a, continues from hash to allow hashing several strings */
+constexpr std::uint32_t fnv1a(const char* text, std::uint32_t hash = 2166136261u)
+{
+    while (*text != '\0')
+    {
+        hash = (hash ^ static_cast<std::uint8_t>(*text++)) * 16777619u;
+    }
+    return hash;
+}
+
+/* Hash of "suite.testcase" */
+constexpr std::uint32_t test_id(const char* suite, const char* testcase)
+{
+    return fnv1a(testcase, fnv1a(".", fnv1a(suite)));
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,87 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+#include "mstest/detail/test_result.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+#if defined(MSTEST_PERF_COUNTERS)
+/* Hardware counters of the calling thread, opened with perf_event_open()
+ * on first use and again in forked workers. They only move between
+ * start_counters() and stop_counters(). Where the kernel refuses them the
+ * tests run as usual and count nothing. */
+void start_counters();
+CounterStats stop_counters();
+/* Why the last attempt to open a counter failed, nullptr if none did */
+const char* counters_error();
+#else
+inline void start_counters()
+{
+}
+
+inline CounterStats stop_counters()
+{
+    return CounterStats{};
+}
+#endif
+
+/* Key of an event in machine readable reports */
+inline const char* counter_name(CounterEvent event)
+{
+    static constexpr const char* names[] = {"instructions", "cycles", "cache_misses", "branch_misses"};
+    return names[static_cast<unsigned>(event)];
+}
+
+/* Available events as text, e.g. "1200 instructions, 800 cycles, 1.50 IPC" */
+inline void format_counters(const CounterStats& counters, char* buffer, std::size_t size)
+{
+    static constexpr const char* labels[] = {"instructions", "cycles", "cache misses", "branch misses"};
+    std::size_t used = 0;
+    buffer[0] = '\0';
+    for (unsigned i = 0; i < static_cast<unsigned>(CounterEvent::count); ++i)
+    {
+        const CounterEvent event = static_cast<CounterEvent>(i);
+        if (counters.has(event) && used < size)
+        {
+            const int written = snprintf(buffer + used, size - used, "%s%llu %s", used != 0 ? ", " : "",
+                static_cast<unsigned long long>(counters[event]), labels[i]);
+            used += written > 0 ? static_cast<std::size_t>(written) : 0;
+        }
+    }
+    if (counters.instructions_per_cycle() != 0 && used < size)
+    {
+        snprintf(buffer + used, size - used, ", %.2f IPC", counters.instructions_per_cycle());
+    }
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,195 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/* Bytes of the shrunk counterexample text kept for the report */
+#ifndef MSTEST_PROPERTY_EXAMPLE_SIZE
+#define MSTEST_PROPERTY_EXAMPLE_SIZE 160
+#endif
+
+/* A repeated test whose p99 latency exceeds its p50 that many times, and
+ * by at least MSTEST_REPEAT_SPREAD_NS, is listed as unstable like one
+ * that failed some runs. The floor keeps scheduling noise of very short
+ * tests out. */
+#ifndef MSTEST_REPEAT_SPREAD
+#define MSTEST_REPEAT_SPREAD 4
+#endif
+
+#ifndef MSTEST_REPEAT_SPREAD_NS
+#define MSTEST_REPEAT_SPREAD_NS 10000
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Heap use of a test, counted only when built with
+ * MSTEST_ALLOCATION_TRACKING. Sizes are usable sizes of the blocks. */
+struct AllocationStats
+{
+    std::uint32_t allocations = 0;
+    /* Blocks of the test freed again, blocks allocated before it started
+     * do not count */
+    std::uint32_t frees = 0;
+    std::uint64_t bytes = 0;
+    /* Bytes of the blocks of the test still allocated */
+    std::int64_t live_bytes = 0;
+    std::int64_t peak_bytes = 0;
+
+    /* Blocks still allocated after teardown */
+    std::uint32_t leaked_blocks() const
+    {
+        return allocations > frees ? allocations - frees : 0;
+    }
+};
+
+/* Hardware events of perf_counters.hpp, indices into CounterStats::counts */
+enum class CounterEvent : std::uint8_t
+{
+    instructions,
+    cycles,
+    cache_misses,
+    branch_misses,
+    count
+};
+
+/* Hardware events counted in user space during execute() of a test, only
+ * on hosts built with MSTEST_PERF_COUNTERS. Events the kernel or the CPU
+ * does not count are missing from available and stay 0. */
+struct CounterStats
+{
+    /* Bit per CounterEvent */
+    std::uint8_t available = 0;
+    std::uint64_t counts[static_cast<unsigned>(CounterEvent::count)] = {};
+
+    bool has(CounterEvent event) const
+    {
+        return (available & (1u << static_cast<unsigned>(event))) != 0;
+    }
+
+    std::uint64_t operator[](CounterEvent event) const
+    {
+        return counts[static_cast<unsigned>(event)];
+    }
+
+    double instructions_per_cycle() const
+    {
+        return has(CounterEvent::instructions) && (*this)[CounterEvent::cycles] != 0
+            ? static_cast<double>((*this)[CounterEvent::instructions]) / static_cast<double>((*this)[CounterEvent::cycles])
+            : 0;
+    }
+
+    CounterStats& operator+=(const CounterStats& other)
+    {
+        available |= other.available;
+        for (unsigned i = 0; i < static_cast<unsigned>(CounterEvent::count); ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+        return *this;
+    }
+};
+
+struct TestResult
+{
+    bool passed = false;
+    /* Took longer than the budget set with MSTEST_TIMEOUT */
+    bool timed_out = false;
+    std::uint32_t budget_ms = 0;
+    std::uint64_t setup_ns = 0;
+    std::uint64_t execute_ns = 0;
+    std::uint64_t teardown_ns = 0;
+    AllocationStats heap;
+    CounterStats counters;
+
+    std::uint64_t total_ns() const
+    {
+        return setup_ns + execute_ns + teardown_ns;
+    }
+};
+
+/* Nanoseconds per iteration over all samples of a benchmark */
+struct BenchmarkStats
+{
+    std::uint64_t iterations = 0;
+    std::uint32_t samples = 0;
+    double min_ns = 0;
+    double median_ns = 0;
+    double p99_ns = 0;
+    double mean_ns = 0;
+
+    double iterations_per_second() const
+    {
+        return mean_ns > 0 ? 1e9 / mean_ns : 0;
+    }
+};
+
+/* Runs of a test repeated with Options::repeat or repeat_for_ms.
+ * Latencies are of whole runs, setup and teardown included, read from a
+ * histogram with a precision of 1/8. */
+struct RepeatStats
+{
+    std::uint32_t runs = 0;
+    std::uint32_t failures = 0;
+    std::uint64_t p50_ns = 0;
+    std::uint64_t p99_ns = 0;
+    std::uint64_t max_ns = 0;
+
+    double failure_rate() const
+    {
+        return runs > 0 ? static_cast<double>(failures) / static_cast<double>(runs) : 0;
+    }
+
+    /* Failed some runs, or its slow runs take far longer than usual */
+    bool unstable() const
+    {
+        return failures != 0 || (p99_ns > p50_ns * MSTEST_REPEAT_SPREAD && p99_ns - p50_ns >= MSTEST_REPEAT_SPREAD_NS);
+    }
+};
+
+/* Generated cases of a property, and its minimal failing input if any */
+struct PropertyStats
+{
+    std::uint64_t seed = 0;
+    std::uint32_t cases = 0;
+    /* Replays that made the failing input smaller */
+    std::uint32_t shrinks = 0;
+    /* Time spent generating and checking cases, shrinking excluded */
+    std::uint64_t duration_ns = 0;
+    bool falsified = false;
+    /* Values drawn by the shrunk case, comma separated */
+    char example[MSTEST_PROPERTY_EXAMPLE_SIZE] = {};
+
+    double cases_per_second() const
+    {
+        return duration_ns > 0 ? static_cast<double>(cases) * 1e9 / static_cast<double>(duration_ns) : 0;
+    }
+};
+
+} // namespace detail
+} // namespace mstest
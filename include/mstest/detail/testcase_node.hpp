@@ -24,33 +24,265 @@
 
 #pragma once
 
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "mstest/detail/clock.hpp"
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/hash.hpp"
+#include "mstest/detail/perf_counters.hpp"
+#include "mstest/detail/test_result.hpp"
 #include "mstest/test.hpp"
 
+/* Fixtures are constructed one at a time in a buffer of that size. Hosts
+ * grow the buffer to the largest fixture instead. */
+#ifndef MSTEST_FIXTURE_ARENA_SIZE
+#define MSTEST_FIXTURE_ARENA_SIZE 1024
+#endif
+
+/* Runs of consecutive tests of suites with hooks a target gathers, so a
+ * suite spread over several translation units sets up once. Runs past
+ * that many stay in place and set their suite up again. */
+#ifndef MSTEST_HOOKED_RUNS
+#define MSTEST_HOOKED_RUNS 32
+#endif
+
+/* Revision of the source file a test is defined in, the result cache only
+ * skips a test as unchanged while its hash stays the same. __TIMESTAMP__ is
+ * the modification time of the source file, changes to headers it includes
+ * go unnoticed. Define it e.g. to a content hash for reproducible builds. */
+#ifndef MSTEST_TEST_FINGERPRINT
+#define MSTEST_TEST_FINGERPRINT __FILE__ " " __TIMESTAMP__
+#endif
+
 namespace mstest
 {
 
+class Task;
 class Test;
 
 namespace detail
 {
 
+/* Constructs the fixture of a test in storage */
+using TestFactory = mstest::Test* (*)(void* storage);
+
+/* Creates the coroutine of an MSTEST_ASYNC body without running it */
+using AsyncBody = mstest::Task (*)(mstest::Test* test);
+
+/* Static setup_suite() or teardown_suite() of a fixture */
+using SuiteHook = void (*)();
+
+/* Hooks the runner calls once around the tests of a suite */
+struct SuiteHooks
+{
+    SuiteHook setup;
+    SuiteHook teardown;
+};
+
+/* Tests of fixtures with the same hooks share their suite state */
+inline bool same_suite(const SuiteHooks* a, const SuiteHooks* b)
+{
+    return a == b || (a != nullptr && b != nullptr && a->setup == b->setup && a->teardown == b->teardown);
+}
+
+template <class Fixture>
+constexpr SuiteHook setup_suite_of()
+{
+    if constexpr (requires { Fixture::setup_suite(); })
+    {
+        return &Fixture::setup_suite;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+template <class Fixture>
+constexpr SuiteHook teardown_suite_of()
+{
+    if constexpr (requires { Fixture::teardown_suite(); })
+    {
+        return &Fixture::teardown_suite;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+template <class Fixture>
+constexpr SuiteHooks suite_hooks{setup_suite_of<Fixture>(), teardown_suite_of<Fixture>()};
+
+template <class Fixture>
+constexpr const SuiteHooks* suite_hooks_of()
+{
+    if constexpr (setup_suite_of<Fixture>() != nullptr || teardown_suite_of<Fixture>() != nullptr)
+    {
+        return &suite_hooks<Fixture>;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+template <class Fixture>
+mstest::Test* construct_fixture(void* storage)
+{
+    return new (storage) Fixture();
+}
+
+template <class Fixture>
+constexpr AsyncBody async_body_of()
+{
+    if constexpr (requires { &Fixture::mstest_async_body; })
+    {
+        return &Fixture::mstest_async_body;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+/* Constant initialized, so nodes need no startup code. The fixture only
+ * exists while the test runs. */
 class TestCaseNode
 {
 public:
-    TestCaseNode(mstest::Test* test, const char* suite, const char* testcase)
-        : suite_(suite)
-        , testcase_(testcase)
-        , test_(test)
-        , next_(nullptr)
+    /* Node without a fixture, e.g. decoded from a report */
+    constexpr TestCaseNode(const char* suite, const char* testcase)
+        : TestCaseNode(nullptr, 0, 1, 0, 0, nullptr, nullptr, suite, testcase)
     {
     }
 
-    bool execute()
+    template <class Fixture>
+    static constexpr TestCaseNode create(const char* suite, const char* testcase, std::uint32_t fingerprint)
     {
-        test_->setup();
-        test_->execute();
-        test_->teardown();
-        return test_->is_passed();
+#if !defined(MSTEST_HOST)
+        static_assert(sizeof(Fixture) <= MSTEST_FIXTURE_ARENA_SIZE, "Fixture does not fit, increase MSTEST_FIXTURE_ARENA_SIZE");
+        static_assert(alignof(Fixture) <= alignof(std::max_align_t), "Fixture alignment is not supported");
+#endif
+        return TestCaseNode(&construct_fixture<Fixture>, sizeof(Fixture), alignof(Fixture), Fixture::mstest_timeout_ms,
+            fingerprint, async_body_of<Fixture>(), suite_hooks_of<Fixture>(), suite, testcase);
+    }
+
+    /* Constructs the fixture in storage of at least fixture_size() bytes */
+    mstest::Test* construct(void* storage) const
+    {
+        return factory_(storage);
+    }
+
+    /* Constructs the fixture in storage of at least fixture_size() bytes,
+     * runs it and destroys it right after teardown. A failed assert_* in
+     * setup or the body jumps straight to teardown, one in teardown to the
+     * destruction of the fixture. Hardware counters only count the
+     * body. */
+    const TestResult& execute(void* storage)
+    {
+        Context& context = Context::get();
+        const std::uint64_t start = Clock::now();
+        mstest::Test* test = construct(storage);
+        context.current_test(test);
+
+        std::jmp_buf escape;
+        std::jmp_buf* const outer = context.escape(&escape);
+        /* Written between setjmp() and a possible longjmp() */
+        volatile std::uint64_t setup_end = 0;
+        volatile std::uint64_t execute_end = 0;
+        if (setjmp(escape) == 0)
+        {
+            test->setup();
+            setup_end = Clock::now();
+            start_counters();
+            test->execute();
+        }
+        /* Also stops them after a failed assert_* */
+        result_.counters = stop_counters();
+        execute_end = Clock::now();
+        if (setup_end == 0)
+        {
+            setup_end = execute_end;
+            result_.counters = CounterStats{};
+        }
+        if (setjmp(escape) == 0)
+        {
+            test->teardown();
+        }
+        context.escape(outer);
+
+        const bool passed = test->is_passed();
+        test->~Test();
+        context.current_test(nullptr);
+        const std::uint64_t end = Clock::now();
+
+        return finish(Clock::to_ns(setup_end - start), Clock::to_ns(execute_end - setup_end), Clock::to_ns(end - execute_end), passed);
+    }
+
+    /* Stores the result of an execution that took that long, the budget
+     * decides whether it timed out */
+    const TestResult& finish(std::uint64_t setup_ns, std::uint64_t execute_ns, std::uint64_t teardown_ns, bool passed)
+    {
+        result_.setup_ns = setup_ns;
+        result_.execute_ns = execute_ns;
+        result_.teardown_ns = teardown_ns;
+
+        result_.budget_ms = timeout_ms_;
+        const std::uint64_t budget_ns = static_cast<std::uint64_t>(result_.budget_ms) * 1000000u;
+        result_.timed_out = budget_ns != 0 && result_.total_ns() > budget_ns;
+        result_.passed = passed && !result_.timed_out;
+        return result_;
+    }
+
+    std::size_t fixture_size() const
+    {
+        return fixture_size_;
+    }
+
+    std::size_t fixture_align() const
+    {
+        return fixture_align_;
+    }
+
+    /* Hooks of the fixture, nullptr when it has none */
+    const SuiteHooks* suite_hooks() const
+    {
+        return suite_hooks_;
+    }
+
+    /* Budget set with MSTEST_TIMEOUT, 0 is unlimited */
+    std::uint32_t timeout_ms() const
+    {
+        return timeout_ms_;
+    }
+
+#if defined(MSTEST_HOST)
+    /* Hash of MSTEST_TEST_FINGERPRINT where the test is defined */
+    std::uint32_t fingerprint() const
+    {
+        return fingerprint_;
+    }
+
+    /* Set for MSTEST_ASYNC tests, runners group them with this */
+    AsyncBody async_body() const
+    {
+        return async_body_;
+    }
+#endif
+
+    /* Result of the last execution */
+    const TestResult& result() const
+    {
+        return result_;
+    }
+
+    void result(const TestResult& result)
+    {
+        result_ = result;
     }
 
     void next(TestCaseNode* next)
@@ -73,16 +305,46 @@ public:
         return suite_;
     }
 
-    Test* test()
+    /* Stable identifier derived from suite and test case names */
+    std::uint32_t id() const
     {
-        return test_;
+        return test_id(suite_, testcase_);
     }
 
 private:
+    constexpr TestCaseNode(TestFactory factory, std::uint32_t fixture_size, std::uint32_t fixture_align, std::uint32_t timeout_ms,
+        [[maybe_unused]] std::uint32_t fingerprint, [[maybe_unused]] AsyncBody async_body, const SuiteHooks* suite_hooks,
+        const char* suite, const char* testcase)
+        : suite_(suite)
+        , testcase_(testcase)
+        , factory_(factory)
+        , fixture_size_(fixture_size)
+        , fixture_align_(fixture_align)
+        , timeout_ms_(timeout_ms)
+        , suite_hooks_(suite_hooks)
+#if defined(MSTEST_HOST)
+        , fingerprint_(fingerprint)
+        , async_body_(async_body)
+#endif
+        , next_(nullptr)
+    {
+    }
+
     const char* suite_;
     const char* testcase_;
-    mstest::Test* test_;
+    TestFactory factory_;
+    std::uint32_t fixture_size_;
+    std::uint32_t fixture_align_;
+    std::uint32_t timeout_ms_;
+    const SuiteHooks* suite_hooks_;
+#if defined(MSTEST_HOST)
+    /* Only the result cache and the host runners need these, targets save
+     * the space and run async tests one at a time */
+    std::uint32_t fingerprint_;
+    AsyncBody async_body_;
+#endif
     TestCaseNode* next_;
+    TestResult result_;
 };
 
 } // namespace detail
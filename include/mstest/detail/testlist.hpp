@@ -26,11 +26,86 @@
 
 #include "mstest/detail/testcase_node.hpp"
 
+/* With MSTEST_SECTION_REGISTRY every test adds a pointer to its node into
+ * a linker section, the linker provides the bounds of that table. Entries
+ * keep declaration order within a translation unit and link order across
+ * them, as registration at startup does, so listing, reports and sharding
+ * by index see the same order with both registries. Custom
+ * linker scripts must keep the section and place it in a loaded region:
+ *
+ *   mstest_tests : { __start_mstest_tests = .; KEEP(*(mstest_tests)) __stop_mstest_tests = .; }
+ */
+#if defined(MSTEST_SECTION_REGISTRY)
+#if !defined(__ELF__)
+#error "MSTEST_SECTION_REGISTRY needs an ELF toolchain"
+#endif
+
+#define MSTEST_DETAIL_SECTION "mstest_tests"
+
+/* Weak, so a binary without tests still links */
+extern "C" mstest::detail::TestCaseNode* const __start_mstest_tests[] __attribute__((weak));
+extern "C" mstest::detail::TestCaseNode* const __stop_mstest_tests[] __attribute__((weak));
+#endif
+
 namespace mstest
 {
 namespace detail
 {
 
+#if defined(MSTEST_SECTION_REGISTRY)
+
+class TestList
+{
+public:
+    class TestListIterator
+    {
+    public:
+        TestListIterator(TestCaseNode* const* entry) : entry_(entry)
+        {
+        }
+
+        TestListIterator& operator++()
+        {
+            ++entry_;
+            return *this;
+        }
+
+        bool operator!=(const TestListIterator& it) const
+        {
+            return entry_ != it.entry_;
+        }
+
+        TestCaseNode& operator*()
+        {
+            return **entry_;
+        }
+
+    private:
+        TestCaseNode* const* entry_;
+    };
+
+    TestListIterator begin()
+    {
+        return TestListIterator(__start_mstest_tests);
+    }
+
+    TestListIterator end()
+    {
+        return TestListIterator(__stop_mstest_tests);
+    }
+
+    static TestList& get()
+    {
+        static TestList list;
+        return list;
+    }
+
+private:
+    TestList() = default;
+};
+
+#else
+
 class TestList
 {
 public:
@@ -103,16 +178,6 @@ public:
         return true;
     }
 
-    void current_test(Test* test)
-    {
-        current_ = test;
-    }
-
-    Test* current_test()
-    {
-        return current_;
-    }
-
     TestCaseNode* root()
     {
         return root_;
@@ -122,9 +187,9 @@ private:
     TestList() = default;
     TestCaseNode* root_ = nullptr;
     TestCaseNode* last_ = nullptr;
-    // TODO: move to context
-    Test* current_;
 };
 
+#endif
+
 } // namespace detail
 } // namespace mstest
@@ -24,124 +24,171 @@
 
 #pragma once
 
-#include <string>
-#include <sstream>
 #include <experimental/source_location>
 
-#include "mstest/detail/colors.hpp"
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/failure_record.hpp"
 
 namespace std
 {
     using source_location = std::experimental::source_location;
+} // namespace std
 
-    /* https://stackoverflow.com/questions/5100718/integer-to-hex-string-in-c */
-    template <typename I> std::string n2hexstr(I w, size_t hex_len = sizeof(I)<<1) {
-        static const char* digits = "0123456789ABCDEF";
-        std::string rc(hex_len,'0');
-        for (size_t i=0, j=(hex_len-1)*4 ; i<hex_len; ++i,j-=4)
-            rc[i] = digits[(w>>j) & 0x0f];
-        return rc;
-    }
-    // TODO: change to custom printers
-    template <typename T>
-    inline std::string to_string(T* x)
-    {
-        return std::string("0x") + n2hexstr(reinterpret_cast<std::size_t>(x));
-    }
 
-    inline std::string to_string(std::string_view x)
+namespace mstest
+{
+namespace detail
+{
+
+/* Failure path of every expectation in compact mode, kept out of line and
+ * out of the hot text so call sites are only a compare and a branch */
+[[gnu::noinline, gnu::cold]] void record_failure(Expectation kind, const std::source_location& location,
+    const OperandReference* operands, std::size_t count);
+
+/* Leaves the running test phase through the escape in the context. Only
+ * returns when there is none, e.g. in a fixture constructor. */
+[[gnu::cold]] void abort_test();
+
+} // namespace detail
+
+/* Fails the current test and records where it happened. Operands are kept
+ * in the failure record and printed by the runner once the test finished.
+ * With MSTEST_COMPACT_EXPECTATIONS every type shares one failure path
+ * instead of instantiating its own, trading a little speed on failure for
+ * flash. */
+template <class... Operands>
+bool generic_matcher(bool passed, detail::Expectation kind, const std::source_location& location, const Operands&... operands)
+{
+#if defined(MSTEST_COMPACT_EXPECTATIONS)
+    if (__builtin_expect(!passed, 0))
     {
-        return std::string(x);
+        const detail::OperandReference references[sizeof...(Operands) + 1] = {{&operands, &detail::operand_descriptor<Operands>}...};
+        detail::record_failure(kind, location, references, sizeof...(Operands));
     }
-
-    inline std::string to_string(const char* str)
+#else
+    if (!passed)
     {
-        return std::string(str);
+        detail::Context& context = detail::Context::get();
+        context.current_test()->fail();
+        context.failures().record(kind, location.file_name(), location.line(), operands...);
     }
-} // namespace std
+#endif
+    return passed;
+}
 
+inline bool generic_matcher(bool passed, const std::source_location& location)
+{
+    return generic_matcher(passed, detail::Expectation::generic, location);
+}
 
-namespace mstest
+template <class T>
+void expect_true(T x, const std::source_location& location = std::source_location::current())
 {
+    generic_matcher(static_cast<bool>(x), detail::Expectation::is_true, location, x);
+}
 
-inline void print_location(const std::source_location& location)
+template <class T>
+constexpr void expect_false(const T& x, const std::source_location& location = std::source_location::current())
 {
-    printf("        Called from: %s:%d\n", location.file_name(), location.line());
+    generic_matcher(!x, detail::Expectation::is_false, location, x);
 }
 
-inline bool generic_matcher(bool passed, const std::source_location& location)
+template <class A, class B>
+constexpr void expect_eq(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!passed)
-    {
-        print_location(location);
-        mstest::detail::TestList::get().current_test()->fail();
-    }
-    return passed;
+    generic_matcher(a == b, detail::Expectation::eq, location, a, b);
+}
+
+template <class A, class B>
+constexpr void expect_gt(A a, B b, const std::source_location& location = std::source_location::current())
+{
+    generic_matcher(a > b, detail::Expectation::gt, location, a, b);
+}
+
+template <class A, class B>
+constexpr void expect_lt(A a, B b, const std::source_location& location = std::source_location::current())
+{
+    generic_matcher(a < b, detail::Expectation::lt, location, a, b);
 }
 
+
+template <class A, class B>
+constexpr void expect_ge(A a, B b, const std::source_location& location = std::source_location::current())
+{
+    generic_matcher(a >= b, detail::Expectation::ge, location, a, b);
+}
+
+template <class A, class B>
+constexpr void expect_le(A a, B b, const std::source_location& location = std::source_location::current())
+{
+    generic_matcher(a <= b, detail::Expectation::le, location, a, b);
+}
+
+/* Fatal variants of the expectations above. A failure ends the running
+ * setup(), body or teardown() right away with a longjmp(), teardown() and
+ * the fixture destructor still run. Objects with destructors living in the
+ * aborted function are not destroyed, keep them in the fixture instead. */
 template <class T>
-void expect_true(T x, const std::source_location& location = std::source_location::current())
+void assert_true(T x, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(x, location))
+    if (!generic_matcher(static_cast<bool>(x), detail::Expectation::assert_true, location, x))
     {
-        printf("    %sAssertion failed:%s expect_true(x), where x = %s\n", detail::color::red, detail::color::reset, std::to_string(x).c_str());
+        detail::abort_test();
     }
 }
 
 template <class T>
-constexpr void expect_false(const T& x, const std::source_location& location = std::source_location::current())
+void assert_false(const T& x, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(!x, location))
+    if (!generic_matcher(!x, detail::Expectation::assert_false, location, x))
     {
-        printf("    %sAssertion failed:%s expect_false(x), where x = %s\n", detail::color::red, detail::color::reset, std::to_string(x).c_str());
+        detail::abort_test();
     }
 }
 
 template <class A, class B>
-constexpr void expect_eq(A a, B b, const std::source_location& location = std::source_location::current())
+void assert_eq(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(a == b, location))
+    if (!generic_matcher(a == b, detail::Expectation::assert_eq, location, a, b))
     {
-        printf("    %sAssertion failed:%s expect_eq(a, b), where a = %s, b = %s\n", detail::color::red, detail::color::reset, std::to_string(a).c_str(), std::to_string(b).c_str());
+        detail::abort_test();
     }
 }
 
 template <class A, class B>
-constexpr void expect_gt(A a, B b, const std::source_location& location = std::source_location::current())
+void assert_gt(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(a > b, location))
+    if (!generic_matcher(a > b, detail::Expectation::assert_gt, location, a, b))
     {
-        printf("    %sAssertion failed:%s expect_gt(a, b), where a = %s, b = %s\n", detail::color::red, detail::color::reset, std::to_string(a).c_str(), std::to_string(b).c_str());
+        detail::abort_test();
     }
 }
 
 template <class A, class B>
-constexpr void expect_lt(A a, B b, const std::source_location& location = std::source_location::current())
+void assert_lt(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(a < b, location))
+    if (!generic_matcher(a < b, detail::Expectation::assert_lt, location, a, b))
     {
-        printf("    %sAssertion failed:%s expect_lt(a, b), where a = %s, b = %s\n", detail::color::red, detail::color::reset, std::to_string(a).c_str(), std::to_string(b).c_str());
+        detail::abort_test();
     }
 }
 
-
 template <class A, class B>
-constexpr void expect_ge(A a, B b, const std::source_location& location = std::source_location::current())
+void assert_ge(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(a >= b, location))
+    if (!generic_matcher(a >= b, detail::Expectation::assert_ge, location, a, b))
     {
-        printf("    %sAssertion failed:%s expect_ge(a, b), where a = %s, b = %s\n", detail::color::red, detail::color::reset, std::to_string(a).c_str(), std::to_string(b).c_str());
+        detail::abort_test();
     }
 }
 
 template <class A, class B>
-constexpr void expect_le(A a, B b, const std::source_location& location = std::source_location::current())
+void assert_le(A a, B b, const std::source_location& location = std::source_location::current())
 {
-    if (!generic_matcher(a <= b, location))
+    if (!generic_matcher(a <= b, detail::Expectation::assert_le, location, a, b))
     {
-        printf("    %sAssertion failed:%s expect_le(a, b), where a = %s, b = %s\n", detail::color::red, detail::color::reset, std::to_string(a).c_str(), std::to_string(b).c_str());
+        detail::abort_test();
     }
 }
 
-
 } // namespace mstest
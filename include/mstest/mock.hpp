@@ -0,0 +1,208 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "mstest/expectations.hpp"
+#include "mstest/printer.hpp"
+
+/* Calls a mock keeps the arguments of, later calls are only counted */
+#ifndef MSTEST_MOCK_CAPACITY
+#define MSTEST_MOCK_CAPACITY 16
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Argument of a recorded call that differs from the expected one */
+template <class T>
+struct CallArgument
+{
+    T value;
+    std::uint32_t call;
+    std::uint32_t position;
+};
+
+} // namespace detail
+
+template <class T>
+struct Printer<detail::CallArgument<T>>
+{
+    static void print(const detail::CallArgument<T>& argument, char* buffer, std::size_t size)
+    {
+        char value[MSTEST_OPERAND_SIZE];
+        Printer<T>::print(argument.value, value, sizeof(value));
+        snprintf(buffer, size, "%s in call %u, argument %u", value, static_cast<unsigned>(argument.call),
+            static_cast<unsigned>(argument.position));
+    }
+};
+
+namespace mock
+{
+
+template <class Signature, std::size_t Capacity = MSTEST_MOCK_CAPACITY>
+class Function;
+
+/* Recording stand-in for a function of an interface the code under test
+ * takes as a template parameter, so calls stay direct and inlinable as in
+ * production instead of going through a vtable. A member of a mock class
+ * is called like a member function, a static inline one like a static
+ * function, e.g. as the implementation a CRTP base forwards to:
+ *
+ *   struct MockBus
+ *   {
+ *       mstest::mock::Function<void(std::uint8_t, std::uint8_t)> write;
+ *       mstest::mock::Function<std::uint8_t(std::uint8_t)> read;
+ *   };
+ *
+ * Arguments of the first Capacity calls are copied into the mock itself,
+ * no heap is used. Failed expectations fail the current test like any
+ * other. mstest_bench reports the cost of a recorded call as
+ * mock_call_ns. */
+template <class R, class... Args, std::size_t Capacity>
+class Function<R(Args...), Capacity>
+{
+public:
+    /* Recorded arguments of one call, copies of what was passed */
+    using Arguments = std::tuple<std::decay_t<Args>...>;
+    using Stub = R (*)(Args...);
+
+private:
+    struct Nothing
+    {
+    };
+    using Result = std::conditional_t<std::is_void_v<R>, Nothing, R>;
+
+public:
+
+    R operator()(Args... args)
+    {
+        if (calls_ < Capacity)
+        {
+            recorded_[calls_] = Arguments(args...);
+        }
+        ++calls_;
+        if (stub_ != nullptr)
+        {
+            return stub_(std::forward<Args>(args)...);
+        }
+        if constexpr (!std::is_void_v<R>)
+        {
+            return result_;
+        }
+    }
+
+    /* Every call returns value, unless a stub is set */
+    void returns(const Result& value) requires(!std::is_void_v<R>)
+    {
+        result_ = value;
+    }
+
+    /* Every call is passed on to stub, e.g. a lambda without captures */
+    void calls_into(Stub stub)
+    {
+        stub_ = stub;
+    }
+
+    std::size_t calls() const
+    {
+        return calls_;
+    }
+
+    /* Calls whose arguments were kept */
+    std::size_t recorded() const
+    {
+        return calls_ < Capacity ? calls_ : Capacity;
+    }
+
+    /* Arguments of the call at index, lower than recorded() */
+    const Arguments& call(std::size_t index) const
+    {
+        return recorded_[index];
+    }
+
+    /* Forgets all calls, what calls return stays */
+    void clear()
+    {
+        calls_ = 0;
+    }
+
+    void expect_calls(std::size_t count, const std::source_location& location = std::source_location::current()) const
+    {
+        generic_matcher(calls_ == count, detail::Expectation::mock_calls, location, count, calls_);
+    }
+
+    void expect_called(const std::source_location& location = std::source_location::current()) const
+    {
+        generic_matcher(calls_ != 0, detail::Expectation::mock_called, location, calls_);
+    }
+
+    /* Compares every argument of the call at index, each one that differs
+     * is a failure of its own */
+    void expect_call(std::size_t index, const Arguments& expected, const std::source_location& location = std::source_location::current()) const
+    {
+        if (generic_matcher(index < recorded(), detail::Expectation::mock_call_missing, location, index, recorded()))
+        {
+            compare(index, expected, location, std::index_sequence_for<Args...>{});
+        }
+    }
+
+    void expect_last_call(const Arguments& expected, const std::source_location& location = std::source_location::current()) const
+    {
+        expect_call(calls_ != 0 ? calls_ - 1 : 0, expected, location);
+    }
+
+private:
+    template <std::size_t... Positions>
+    void compare(std::size_t index, const Arguments& expected, const std::source_location& location,
+        std::index_sequence<Positions...>) const
+    {
+        const Arguments& actual = recorded_[index];
+        (compare_argument<Positions>(std::get<Positions>(actual), std::get<Positions>(expected), index, location), ...);
+    }
+
+    template <std::size_t Position, class T>
+    static void compare_argument(const T& actual, const T& expected, std::size_t index, const std::source_location& location)
+    {
+        generic_matcher(actual == expected, detail::Expectation::mock_argument, location,
+            detail::CallArgument<T>{actual, static_cast<std::uint32_t>(index), Position}, expected);
+    }
+
+    std::size_t calls_ = 0;
+    Stub stub_ = nullptr;
+    [[no_unique_address]] Result result_{};
+    Arguments recorded_[Capacity];
+};
+
+} // namespace mock
+} // namespace mstest
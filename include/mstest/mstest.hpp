@@ -24,11 +24,15 @@
 
 #pragma once
 
-#include <string>
 #include <experimental/source_location>
 
+#include "mstest/allocations.hpp"
+#include "mstest/reporter.hpp"
 #include "mstest/test_macros.hpp"
 #include "mstest/expectations.hpp"
+#include "mstest/mock.hpp"
 #include "mstest/runner.hpp"
+#include "mstest/server.hpp"
+#include "mstest/span_expectations.hpp"
 
 
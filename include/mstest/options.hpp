@@ -0,0 +1,139 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mstest/output.hpp"
+
+/* Filter string of Options::filter when none is given, e.g. to select
+ * tests of a target build without a command line */
+#ifndef MSTEST_DEFAULT_FILTER
+#define MSTEST_DEFAULT_FILTER nullptr
+#endif
+
+namespace mstest
+{
+
+class Reporter;
+
+enum class Format
+{
+    /* Colored text */
+    console,
+    /* Varint frames for slow links, see detail/binary_protocol.hpp */
+    binary,
+    junit,
+    /* JSON Lines */
+    json
+};
+
+struct Options
+{
+    /* Worker threads, or worker processes when isolated.
+     * 0 selects one worker per hardware thread. */
+    std::size_t jobs = 1;
+    /* Execute every test in a pre-forked child process */
+    bool isolate = false;
+    /* Run only tests with index % shard_count == shard_index */
+    std::size_t shard_index = 0;
+    std::size_t shard_count = 1;
+    /* Run the tests a manifest assigns to shard_index instead, tests it
+     * does not list are sharded by index. Host only. */
+    const char* shard_plan_file = nullptr;
+    /* run_tests() writes a manifest of the tests balanced over
+     * shard_count shards instead of running them. Host only. */
+    bool manifest = false;
+    /* Result cache the manifest takes durations from, cache_file when
+     * nullptr */
+    const char* durations_file = nullptr;
+    /* Length of the slowest tests table printed after the summary */
+    std::size_t slowest = 5;
+    /* Abort a test still running after that long. When 0, only tests with
+     * a MSTEST_TIMEOUT budget are aborted, MSTEST_WATCHDOG_GRACE_MS past
+     * the budget in process or right at the budget when isolated. A test
+     * that comes back over budget just fails. Host only. */
+    std::uint32_t hang_timeout_ms = 0;
+    Format format = Format::console;
+    /* Overrides format when set */
+    Reporter* reporter = nullptr;
+    /* Destination of the buffered report, stdout when nullptr. Formats
+     * other than console must not share it with what tests print: on host
+     * they keep stdout to themselves and test output goes to stderr, a
+     * target needs a write function to a channel of their own. */
+    WriteFunction write = nullptr;
+    bool color = true;
+    /* Console only lists failed tests */
+    bool quiet = false;
+    /* Property tests draw the same cases on every run with the same seed */
+    std::uint64_t seed = 0;
+    /* Cases generated per property, 0 selects MSTEST_PROPERTY_CASES */
+    std::uint32_t property_cases = 0;
+    /* Stop starting tests once that many failed, 0 runs all of them.
+     * When set, a repeated test also stops at its first failed run. */
+    std::size_t max_failures = 0;
+    /* Run every test that many times with a fresh fixture, or as often as
+     * fits in repeat_for_ms when that is set. A test passes only when all
+     * its runs do, reporters get the first failed run. */
+    std::uint32_t repeat = 1;
+    std::uint32_t repeat_for_ms = 0;
+    /* Results of the previous run are read from and written to that file,
+     * nothing is cached when nullptr. Host only. */
+    const char* cache_file = nullptr;
+    /* Run tests that failed in the cached run before all others */
+    bool failed_first = false;
+    /* Skip tests that passed in the cached run and whose source file has
+     * the same fingerprint, see MSTEST_TEST_FINGERPRINT */
+    bool skip_unchanged = false;
+    /* Timings of previous runs, a test slower than its baseline by more
+     * than baseline_tolerance_percent fails. Nothing is compared when
+     * nullptr. Host only. */
+    const char* baseline_file = nullptr;
+    std::uint32_t baseline_tolerance_percent = 10;
+    /* Add the timings of passing tests to the baseline instead of
+     * comparing them */
+    bool update_baseline = false;
+    /* Run only tests matching one of these patterns, globs over
+     * "suite.testcase" or ids written as 0x1234abcd. An entry may hold
+     * several patterns separated by ':', a pattern starting with '-'
+     * excludes the tests it matches. All tests when empty. */
+    const char* const* filters = nullptr;
+    std::size_t filter_count = 0;
+    /* Patterns as in filters, tests have to pass both */
+    const char* filter = MSTEST_DEFAULT_FILTER;
+    /* run_tests() prints the names of the selected tests in the order
+     * they would run instead of running them */
+    bool list = false;
+    /* run_tests(argc, argv) takes commands from stdin instead of running
+     * the tests once, see serve() */
+    bool serve = false;
+};
+
+/* Fills options from command line flags, prints usage and returns false
+ * on unknown or malformed flags. */
+bool parse_options(int argc, char* argv[], Options& options);
+
+} // namespace mstest
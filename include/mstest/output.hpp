@@ -0,0 +1,77 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+/* Bytes collected before reporters output is written out */
+#ifndef MSTEST_OUTPUT_BUFFER_SIZE
+#if defined(MSTEST_HOST)
+#define MSTEST_OUTPUT_BUFFER_SIZE 65536
+#else
+#define MSTEST_OUTPUT_BUFFER_SIZE 512
+#endif
+#endif
+
+namespace mstest
+{
+
+/* Receives report output in large chunks, e.g. to send it over a UART */
+using WriteFunction = void (*)(const void* data, std::size_t size);
+
+/* Block buffered destination of reporters. Output is written when the
+ * buffer is full and at the end of a run, console text also before each
+ * test of a sequential run so what the test prints follows the report so
+ * far. A slow link sees a few large writes instead of one per line. */
+class Output
+{
+public:
+    /* nullptr writes to stdout */
+    explicit Output(WriteFunction write = nullptr);
+    ~Output();
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    void destination(WriteFunction write);
+    /* Stream written to without a write function, nullptr selects stdout */
+    void stream(std::FILE* stream);
+
+    /* Text longer than the whole buffer is truncated */
+    void print(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void write(const void* data, std::size_t size);
+    void flush();
+
+private:
+    void write_out(const void* data, std::size_t size);
+
+    WriteFunction write_;
+    std::FILE* stream_ = nullptr;
+    std::size_t size_ = 0;
+    char buffer_[MSTEST_OUTPUT_BUFFER_SIZE];
+};
+
+} // namespace mstest
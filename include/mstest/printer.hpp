@@ -0,0 +1,166 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace mstest
+{
+
+/* Formats expectation operands into a failure message. Specialize it to
+ * print custom types:
+ *
+ *   template <>
+ *   struct mstest::Printer<Point>
+ *   {
+ *       static void print(const Point& p, char* buffer, std::size_t size)
+ *       {
+ *           snprintf(buffer, size, "(%d, %d)", p.x, p.y);
+ *       }
+ *   };
+ *
+ * Trivially copyable operands are copied into the failure record and
+ * printed after the test finished. Set `static constexpr bool deferred =
+ * false` when the value refers to memory that may be gone by then, the
+ * operand is formatted immediately instead. */
+template <class T, class Enable = void>
+struct Printer
+{
+    static void print(const T& value, char* buffer, std::size_t size)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            snprintf(buffer, size, "%s", value ? "true" : "false");
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            Printer<std::underlying_type_t<T>>::print(static_cast<std::underlying_type_t<T>>(value), buffer, size);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            snprintf(buffer, size, "%Lg", static_cast<long double>(value));
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            snprintf(buffer, size, "%lld", static_cast<long long>(value));
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            snprintf(buffer, size, "%llu", static_cast<unsigned long long>(value));
+        }
+        else if constexpr (std::is_null_pointer_v<T>)
+        {
+            snprintf(buffer, size, "nullptr");
+        }
+        else if constexpr (std::is_pointer_v<T>)
+        {
+            snprintf(buffer, size, "0x%0*llX", static_cast<int>(sizeof(T) * 2),
+                static_cast<unsigned long long>(reinterpret_cast<std::uintptr_t>(value)));
+        }
+        else
+        {
+            snprintf(buffer, size, "<%u byte object>", static_cast<unsigned>(sizeof(T)));
+        }
+    }
+};
+
+template <>
+struct Printer<const char*>
+{
+    static constexpr bool deferred = false;
+
+    static void print(const char* value, char* buffer, std::size_t size)
+    {
+        snprintf(buffer, size, "%s", value != nullptr ? value : "nullptr");
+    }
+};
+
+template <>
+struct Printer<char*> : Printer<const char*>
+{
+};
+
+/* Any contiguous character container, e.g. std::string or std::string_view */
+template <class T>
+struct Printer<T, std::void_t<decltype(std::declval<const T&>().data()), decltype(std::declval<const T&>().size())>>
+{
+    static constexpr bool deferred = false;
+
+    static void print(const T& value, char* buffer, std::size_t size)
+    {
+        using Element = std::remove_cv_t<std::remove_pointer_t<decltype(value.data())>>;
+        if constexpr (std::is_same_v<Element, char>)
+        {
+            snprintf(buffer, size, "%.*s", static_cast<int>(value.size()), value.data());
+        }
+        else if constexpr (std::is_arithmetic_v<Element>)
+        {
+            /* {1, 2, 3}, elements that do not fit end in ... */
+            std::size_t used = static_cast<std::size_t>(snprintf(buffer, size, "{"));
+            for (std::size_t i = 0; i < value.size() && used < size; ++i)
+            {
+                char element[32];
+                Printer<Element>::print(value.data()[i], element, sizeof(element));
+                const std::size_t room = size - used;
+                const std::size_t needed = strlen(element) + (i != 0 ? 2 : 0) + 1;
+                if (needed + 4 > room && i + 1 != value.size())
+                {
+                    snprintf(buffer + used, room, "%s...}", i != 0 ? ", " : "");
+                    return;
+                }
+                used += static_cast<std::size_t>(snprintf(buffer + used, room, "%s%s", i != 0 ? ", " : "", element));
+            }
+            if (used < size)
+            {
+                snprintf(buffer + used, size - used, "}");
+            }
+        }
+        else
+        {
+            snprintf(buffer, size, "<container of %u elements>", static_cast<unsigned>(value.size()));
+        }
+    }
+};
+
+namespace detail
+{
+
+template <class T, class Enable = void>
+struct printer_defers : std::true_type
+{
+};
+
+template <class T>
+struct printer_defers<T, std::void_t<decltype(Printer<T>::deferred)>> : std::bool_constant<Printer<T>::deferred>
+{
+};
+
+} // namespace detail
+} // namespace mstest
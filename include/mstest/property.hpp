@@ -0,0 +1,227 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "mstest/detail/test_result.hpp"
+#include "mstest/printer.hpp"
+
+/* Cases generated per property unless Options::property_cases is set */
+#ifndef MSTEST_PROPERTY_CASES
+#define MSTEST_PROPERTY_CASES 1000
+#endif
+
+/* Choices one case may make, later draws get the simplest value */
+#ifndef MSTEST_PROPERTY_MAX_CHOICES
+#if defined(MSTEST_HOST)
+#define MSTEST_PROPERTY_MAX_CHOICES 1024
+#else
+#define MSTEST_PROPERTY_MAX_CHOICES 128
+#endif
+#endif
+
+/* Replays spent shrinking a failing case at most */
+#ifndef MSTEST_PROPERTY_SHRINK_REPLAYS
+#define MSTEST_PROPERTY_SHRINK_REPLAYS 2000
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* splitmix64, cheap and good enough to generate inputs */
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed = 0)
+        : state_(seed)
+    {
+    }
+
+    std::uint64_t next()
+    {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15u);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+        return z ^ (z >> 31);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+/* Every input of a case is built from choices, integers in [0, bound].
+ * Shrinking edits the choices instead of the values, so generators shrink
+ * without knowing how. Choice 0 always gives the simplest value. */
+struct ChoiceSequence
+{
+    std::uint64_t values[MSTEST_PROPERTY_MAX_CHOICES];
+    std::size_t size = 0;
+};
+
+using PropertyBody = void (*)(void* property);
+
+class PropertyRunner;
+
+void run_property(std::uint32_t id, PropertyBody body, void* property);
+
+} // namespace detail
+
+/* Where generators take their choices from, random ones while generating
+ * and recorded ones while shrinking. A generator is any callable taking a
+ * Source& and returning a value, e.g.
+ *
+ *   auto packets = [](mstest::Source& source) {
+ *       return Packet{source.draw(mstest::integers<std::uint8_t>()), source.draw(mstest::bytes(0, 16))};
+ *   };
+ */
+class Source
+{
+public:
+    /* Integer in [0, bound], generation favours both ends */
+    std::uint64_t choice(std::uint64_t bound);
+    /* Whether a collection gets another element, shrinks to false */
+    bool more();
+
+    template <class Generator>
+    auto draw(const Generator& generator)
+    {
+        ++depth_;
+        auto value = generator(*this);
+        --depth_;
+        /* Only values the property itself draws make up the example */
+        if (depth_ == 0 && example_ != nullptr)
+        {
+            char text[MSTEST_PROPERTY_EXAMPLE_SIZE];
+            Printer<decltype(value)>::print(value, text, sizeof(text));
+            describe(text);
+        }
+        return value;
+    }
+
+    /* Source of the property running on the calling thread */
+    static Source& current()
+    {
+        return *current_pointer();
+    }
+
+private:
+    friend class detail::PropertyRunner;
+    friend void detail::run_property(std::uint32_t id, detail::PropertyBody body, void* property);
+
+    static Source*& current_pointer();
+
+    void generate(std::uint64_t seed, detail::ChoiceSequence& record);
+    void replay(const detail::ChoiceSequence& choices, detail::ChoiceSequence& record, char* example = nullptr);
+    void push(std::uint64_t& value, std::uint64_t bound);
+    void describe(const char* text);
+
+    detail::Random random_;
+    const detail::ChoiceSequence* replay_ = nullptr;
+    detail::ChoiceSequence* record_ = nullptr;
+    unsigned depth_ = 0;
+    char* example_ = nullptr;
+    std::size_t example_used_ = 0;
+};
+
+/* Draws a value in the property running on the calling thread */
+template <class Generator>
+auto draw(const Generator& generator)
+{
+    return Source::current().draw(generator);
+}
+
+/* Integers in [min, max], shrinking towards the value closest to zero */
+template <class T>
+auto integers(T min = std::numeric_limits<T>::min(), T max = std::numeric_limits<T>::max())
+{
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "integers() needs an integer type");
+    return [min, max](Source& source) {
+        using U = std::make_unsigned_t<T>;
+        const std::uint64_t range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+        /* Offsets from min of zero, or of the bound nearest to it */
+        const std::uint64_t origin = min > 0 ? 0 : max < 0 ? range : static_cast<U>(static_cast<U>(0) - static_cast<U>(min));
+        const std::uint64_t up = range - origin;
+        const std::uint64_t down = origin;
+        const std::uint64_t both = up < down ? up : down;
+
+        /* 0, +1, -1, +2, -2, ... then the rest of the longer side */
+        const std::uint64_t choice = source.choice(range);
+        std::uint64_t offset;
+        if (choice / 2 < both || (choice / 2 == both && choice % 2 == 0))
+        {
+            offset = choice % 2 ? origin + (choice + 1) / 2 : origin - choice / 2;
+        }
+        else
+        {
+            const std::uint64_t rest = choice - 2 * both;
+            offset = up > down ? origin + both + rest : origin - both - rest;
+        }
+        return static_cast<T>(static_cast<U>(static_cast<U>(min) + static_cast<U>(offset)));
+    };
+}
+
+inline auto booleans()
+{
+    return [](Source& source) { return source.choice(1) != 0; };
+}
+
+/* Between min_size and max_size elements drawn from element */
+template <class Element>
+auto vectors(Element element, std::size_t min_size = 0, std::size_t max_size = 64)
+{
+    return [element, min_size, max_size](Source& source) {
+        std::vector<decltype(element(source))> values;
+        while (values.size() < max_size && (values.size() < min_size || source.more()))
+        {
+            values.push_back(source.draw(element));
+        }
+        return values;
+    };
+}
+
+/* Byte buffers, e.g. protocol frames */
+inline auto bytes(std::size_t min_size = 0, std::size_t max_size = 64)
+{
+    return vectors(integers<std::uint8_t>(), min_size, max_size);
+}
+
+namespace detail
+{
+
+template <class Property>
+void call_property(void* property)
+{
+    static_cast<Property*>(property)->property();
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,124 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/testcase_node.hpp"
+#include "mstest/options.hpp"
+#include "mstest/output.hpp"
+
+#ifndef MSTEST_MAX_SLOWEST
+#define MSTEST_MAX_SLOWEST 32
+#endif
+
+/* Unstable repeated tests listed in the summary, later ones are left out */
+#ifndef MSTEST_MAX_UNSTABLE
+#define MSTEST_MAX_UNSTABLE 8
+#endif
+
+namespace mstest
+{
+
+using TestCase = detail::TestCaseNode;
+using Failure = detail::FailureRecord;
+using TestRecord = detail::TestRecord;
+
+struct Summary
+{
+    int executed = 0;
+    int passed = 0;
+    /* Selected tests that did not run, unchanged since a cached pass or
+     * left after Options::max_failures */
+    int skipped = 0;
+    /* Slowest tests, longest first */
+    std::size_t slowest_count = 0;
+    const TestCase* slowest[MSTEST_MAX_SLOWEST];
+    /* Heap allocations of all tests, and the tests making most of them */
+    std::uint64_t allocations = 0;
+    std::size_t most_allocating_count = 0;
+    const TestCase* most_allocating[MSTEST_MAX_SLOWEST];
+    /* Repeated tests that failed some runs or vary a lot, in report order */
+    struct Unstable
+    {
+        const TestCase* test;
+        detail::RepeatStats stats;
+    };
+    std::size_t unstable_count = 0;
+    Unstable unstable[MSTEST_MAX_UNSTABLE];
+    /* Hardware events of all tests, see MSTEST_PERF_COUNTERS */
+    detail::CounterStats counters;
+};
+
+/* Turns events of a run into output. Events arrive on the thread that
+ * called run_tests(), in registration order, whatever runner executed the
+ * tests. For every test: test_start(), failure() for each recorded
+ * failure, note() for runner messages such as a crash, then test_end()
+ * with the result in test.result() and the whole record again, for
+ * reporters that write a test at once. Set one with Options::reporter. */
+class Reporter
+{
+public:
+    virtual ~Reporter() = default;
+
+    virtual void run_start(Output&, const Options&, std::size_t /* tests */)
+    {
+    }
+
+    virtual void suite_start(Output&, const char* /* suite */)
+    {
+    }
+
+    virtual void test_start(Output&, const TestCase&)
+    {
+    }
+
+    virtual void failure(Output&, const TestCase&, const Failure&)
+    {
+    }
+
+    virtual void note(Output&, const TestCase&, const char* /* title */, const char* /* text */)
+    {
+    }
+
+    virtual void test_end(Output&, const TestCase&, const TestRecord&)
+    {
+    }
+
+    virtual void run_end(Output&, const Summary&)
+    {
+    }
+};
+
+Reporter& console_reporter();
+/* Frames of detail/binary_protocol.hpp, decoded by mstest_decode */
+Reporter& binary_reporter();
+Reporter& junit_reporter();
+/* One JSON object per line */
+Reporter& json_reporter();
+
+} // namespace mstest
@@ -24,9 +24,22 @@
 
 #pragma once
 
+#include <cstddef>
+
+#include "mstest/options.hpp"
+
 namespace mstest
 {
 
 int run_tests();
+int run_tests(const Options& options);
+/* Parses command line flags, see parse_options() */
+int run_tests(int argc, char* argv[]);
+
+#if defined(MSTEST_HOST)
+/* Runs tests on a pool of worker threads, 0 selects one worker per
+ * hardware thread. Output is identical to run_tests(). */
+int run_tests_parallel(std::size_t threads = 0);
+#endif
 
 } // namespace mstest
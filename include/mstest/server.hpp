@@ -0,0 +1,82 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "mstest/options.hpp"
+#include "mstest/output.hpp"
+
+/* Longest command line the server accepts */
+#ifndef MSTEST_SERVER_LINE_SIZE
+#define MSTEST_SERVER_LINE_SIZE 256
+#endif
+
+/* Patterns a single command may list */
+#ifndef MSTEST_SERVER_MAX_PATTERNS
+#define MSTEST_SERVER_MAX_PATTERNS 16
+#endif
+
+namespace mstest
+{
+
+/* Reads at least one byte, blocking until there is one. Returns the number
+ * of bytes read, 0 at the end of the stream. */
+using ReadFunction = std::size_t (*)(void* data, std::size_t size);
+
+/* Byte stream a server is driven over, e.g. a UART, semihosting or a pty */
+struct Channel
+{
+    ReadFunction read;
+    WriteFunction write;
+};
+
+/* stdin and stdout, what --serve uses */
+const Channel& stdio_channel();
+
+/* Publishes the test table, then runs commands read from channel until
+ * "stop" or the end of the stream. Commands are text lines:
+ *
+ *   list [PATTERN...]            prints the table of matching tests
+ *   run [PATTERN...]             runs matching tests, all without patterns
+ *   repeat N [PATTERN...]        runs them up to N times, ends after the
+ *                                first run with a failure
+ *   stop                         ends the session
+ *
+ * Patterns are those of Options::filters. Reports are written to the
+ * channel in the format of options. Lines of the server itself start with
+ * '#', so a host can tell them from reports:
+ *
+ *   #tests COUNT                 header of a table, followed by
+ *   #test 0x1234abcd suite.case  one line per test
+ *   #done FAILED [RUNS]          end of run and repeat
+ *   #error MESSAGE               rejected command
+ *   #ready                       waiting for the next command
+ *   #bye                         answer to stop
+ *
+ * Returns what the last run returned, see run_tests(). */
+int serve(const Channel& channel, const Options& options = Options{});
+
+} // namespace mstest
@@ -0,0 +1,300 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "mstest/expectations.hpp"
+#include "mstest/printer.hpp"
+
+/* Mismatching elements a failed span expectation lists one by one, the
+ * rest is only counted */
+#ifndef MSTEST_MISMATCH_DETAILS
+#define MSTEST_MISMATCH_DETAILS 3
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+struct MismatchCount
+{
+    std::uint32_t mismatches;
+    std::uint32_t size;
+};
+
+struct LargestError
+{
+    double error;
+    std::uint32_t index;
+    bool in_ulp;
+};
+
+template <class T>
+struct Element
+{
+    T value;
+    std::uint32_t index;
+};
+
+/* Element value printed with all the digits that tell neighbours apart */
+template <class T>
+struct RoundTrip
+{
+    T value;
+};
+
+template <class T>
+void print_round_trip(const T& value, char* buffer, std::size_t size)
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        snprintf(buffer, size, "%.9g", static_cast<double>(value));
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        snprintf(buffer, size, "%.17g", value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        snprintf(buffer, size, "%.21Lg", static_cast<long double>(value));
+    }
+    else
+    {
+        Printer<T>::print(value, buffer, size);
+    }
+}
+
+/* What a compare kernel found, the first mismatches and the largest one */
+struct MismatchSummary
+{
+    std::size_t mismatches = 0;
+    std::size_t first[MSTEST_MISMATCH_DETAILS] = {};
+    std::size_t first_count = 0;
+    double largest = 0;
+    std::size_t largest_index = 0;
+
+    void add(std::size_t index, double error)
+    {
+        if (first_count < MSTEST_MISMATCH_DETAILS)
+        {
+            first[first_count++] = index;
+        }
+        /* NaN is the largest error there is */
+        if (mismatches == 0 || error > largest || (error != error && largest == largest))
+        {
+            largest = error;
+            largest_index = index;
+        }
+        ++mismatches;
+    }
+};
+
+/* Compare kernels, vectorized where the host has SSE2 or AVX. Elements
+ * are near when equal, or when their difference is within abs_tolerance
+ * or within rel_tolerance of the larger magnitude. NaN is never near. */
+void compare_near(const float* a, const float* b, std::size_t size, double abs_tolerance, double rel_tolerance,
+    MismatchSummary& summary);
+void compare_near(const double* a, const double* b, std::size_t size, double abs_tolerance, double rel_tolerance,
+    MismatchSummary& summary);
+/* Distance in representable values between a and b, +0 and -0 are equal */
+void compare_ulp(const float* a, const float* b, std::size_t size, std::uint64_t max_ulp, MismatchSummary& summary);
+void compare_ulp(const double* a, const double* b, std::size_t size, std::uint64_t max_ulp, MismatchSummary& summary);
+
+template <class T>
+double element_error(T a, T b)
+{
+    if constexpr (std::is_enum_v<T>)
+    {
+        using Underlying = std::underlying_type_t<T>;
+        return element_error(static_cast<Underlying>(a), static_cast<Underlying>(b));
+    }
+    else
+    {
+        const double difference = static_cast<double>(a) - static_cast<double>(b);
+        return difference < 0 ? -difference : difference;
+    }
+}
+
+template <class T>
+void compare_equal(const T* a, const T* b, std::size_t size, MismatchSummary& summary)
+{
+    /* memcmp is vectorized by every libc, only a mismatch needs a scan */
+    if constexpr (std::has_unique_object_representations_v<T>)
+    {
+        if (memcmp(a, b, size * sizeof(T)) == 0)
+        {
+            return;
+        }
+    }
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (!(a[i] == b[i]))
+        {
+            summary.add(i, element_error(a[i], b[i]));
+        }
+    }
+}
+
+template <class T>
+bool same_size(std::span<const T> a, std::span<const T> b, const std::source_location& location)
+{
+    return generic_matcher(a.size() == b.size(), Expectation::buffer_sizes, location, a.size(), b.size());
+}
+
+/* One summary record, then one record per listed mismatch */
+template <class T>
+void report_mismatches(Expectation kind, std::span<const T> a, std::span<const T> b, const MismatchSummary& summary, bool in_ulp,
+    const std::source_location& location)
+{
+    if (summary.mismatches == 0)
+    {
+        return;
+    }
+    generic_matcher(false, kind, location, MismatchCount{static_cast<std::uint32_t>(summary.mismatches), static_cast<std::uint32_t>(a.size())},
+        LargestError{summary.largest, static_cast<std::uint32_t>(summary.largest_index), in_ulp});
+    for (std::size_t i = 0; i < summary.first_count; ++i)
+    {
+        const std::size_t index = summary.first[i];
+        generic_matcher(false, Expectation::buffer_element, location, Element<T>{a[index], static_cast<std::uint32_t>(index)},
+            RoundTrip<T>{b[index]});
+    }
+}
+
+} // namespace detail
+
+template <>
+struct Printer<detail::MismatchCount>
+{
+    static void print(const detail::MismatchCount& count, char* buffer, std::size_t size)
+    {
+        snprintf(buffer, size, "%u of %u", static_cast<unsigned>(count.mismatches), static_cast<unsigned>(count.size));
+    }
+};
+
+template <>
+struct Printer<detail::LargestError>
+{
+    static void print(const detail::LargestError& largest, char* buffer, std::size_t size)
+    {
+        snprintf(buffer, size, "%g%s at [%u]", largest.error, largest.in_ulp ? " ulp" : "", static_cast<unsigned>(largest.index));
+    }
+};
+
+template <class T>
+struct Printer<detail::Element<T>>
+{
+    static void print(const detail::Element<T>& element, char* buffer, std::size_t size)
+    {
+        char value[MSTEST_OPERAND_SIZE];
+        detail::print_round_trip(element.value, value, sizeof(value));
+        snprintf(buffer, size, "%s at [%u]", value, static_cast<unsigned>(element.index));
+    }
+};
+
+template <class T>
+struct Printer<detail::RoundTrip<T>>
+{
+    static void print(const detail::RoundTrip<T>& element, char* buffer, std::size_t size)
+    {
+        detail::print_round_trip(element.value, buffer, size);
+    }
+};
+
+/* Span expectations compare whole buffers, anything std::span can be built
+ * from, in one pass. A failure records one summary with the number of
+ * mismatches and the largest error, followed by the first
+ * MSTEST_MISMATCH_DETAILS mismatching elements. */
+
+/* Element wise ==, for integers, enums and std::byte */
+template <class A, class B>
+void expect_buffers_eq(const A& a, const B& b, const std::source_location& location = std::source_location::current())
+{
+    const std::span actual(a);
+    const std::span expected(b);
+    using T = std::remove_const_t<typename decltype(actual)::element_type>;
+    static_assert(std::is_same_v<T, std::remove_const_t<typename decltype(expected)::element_type>>, "Buffers must have the same element type");
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Buffers of arithmetic or enum elements only");
+    const std::span<const T> x(actual);
+    const std::span<const T> y(expected);
+    if (!detail::same_size(x, y, location))
+    {
+        return;
+    }
+    detail::MismatchSummary summary;
+    detail::compare_equal(x.data(), y.data(), x.size(), summary);
+    detail::report_mismatches(detail::Expectation::buffers_eq, x, y, summary, false, location);
+}
+
+/* Every element of a within abs_tolerance of b, or within rel_tolerance
+ * of the larger magnitude of the two */
+template <class A, class B>
+void expect_all_near(const A& a, const B& b, double abs_tolerance, double rel_tolerance = 0,
+    const std::source_location& location = std::source_location::current())
+{
+    const std::span actual(a);
+    const std::span expected(b);
+    using T = std::remove_const_t<typename decltype(actual)::element_type>;
+    static_assert(std::is_same_v<T, std::remove_const_t<typename decltype(expected)::element_type>>, "Buffers must have the same element type");
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Buffers of float or double only");
+    const std::span<const T> x(actual);
+    const std::span<const T> y(expected);
+    if (!detail::same_size(x, y, location))
+    {
+        return;
+    }
+    detail::MismatchSummary summary;
+    detail::compare_near(x.data(), y.data(), x.size(), abs_tolerance, rel_tolerance, summary);
+    detail::report_mismatches(detail::Expectation::all_near, x, y, summary, false, location);
+}
+
+/* Every element of a at most max_ulp representable values away from b */
+template <class A, class B>
+void expect_all_near_ulp(const A& a, const B& b, std::uint64_t max_ulp,
+    const std::source_location& location = std::source_location::current())
+{
+    const std::span actual(a);
+    const std::span expected(b);
+    using T = std::remove_const_t<typename decltype(actual)::element_type>;
+    static_assert(std::is_same_v<T, std::remove_const_t<typename decltype(expected)::element_type>>, "Buffers must have the same element type");
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Buffers of float or double only");
+    const std::span<const T> x(actual);
+    const std::span<const T> y(expected);
+    if (!detail::same_size(x, y, location))
+    {
+        return;
+    }
+    detail::MismatchSummary summary;
+    detail::compare_ulp(x.data(), y.data(), x.size(), max_ulp, summary);
+    detail::report_mismatches(detail::Expectation::all_near_ulp, x, y, summary, true, location);
+}
+
+} // namespace mstest
@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace mstest
 {
 
@@ -41,6 +43,10 @@ class Test
 
         virtual void execute() = 0;
 
+        /* Budget for setup, execute and teardown together, 0 is unlimited.
+         * Hidden in fixtures with MSTEST_TIMEOUT. */
+        static constexpr std::uint32_t mstest_timeout_ms = 0;
+
         bool is_passed()
         {
             return passed_;
@@ -24,18 +24,43 @@
 
 #pragma once
 
+#include "mstest/async.hpp"
+#include "mstest/benchmark.hpp"
+#include "mstest/property.hpp"
 #include "mstest/test.hpp"
 #include "mstest/detail/testcase_node.hpp"
 #include "mstest/detail/testlist.hpp"
 
+/* Time budget of a fixture, every MSTEST_F using it fails when it takes
+ * longer. Leaves the class in public access. */
+#define MSTEST_TIMEOUT(milliseconds) \
+    public: \
+        static constexpr std::uint32_t mstest_timeout_ms = milliseconds;
+
+#if defined(MSTEST_SECTION_REGISTRY)
+/* GCC emits the table entries of a translation unit in reverse unless
+ * told to keep them in declaration order. Clang keeps the order. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define MSTEST_DETAIL_NO_REORDER no_reorder,
+#else
+#define MSTEST_DETAIL_NO_REORDER
+#endif
+
+#define MSTEST_DETAIL_REGISTER(fixture, testcase) \
+    static mstest::detail::TestCaseNode __mstest_test_case_node_##fixture##_##testcase = mstest::detail::TestCaseNode::create<__mstest_##fixture##_##testcase>(#fixture, #testcase, mstest::detail::fnv1a(MSTEST_TEST_FINGERPRINT)); \
+    __attribute__((used, MSTEST_DETAIL_NO_REORDER section(MSTEST_DETAIL_SECTION))) static mstest::detail::TestCaseNode* const __mstest_test_case_node_##fixture##_##testcase##_ = &__mstest_test_case_node_##fixture##_##testcase
+#else
+#define MSTEST_DETAIL_REGISTER(fixture, testcase) \
+    static mstest::detail::TestCaseNode __mstest_test_case_node_##fixture##_##testcase = mstest::detail::TestCaseNode::create<__mstest_##fixture##_##testcase>(#fixture, #testcase, mstest::detail::fnv1a(MSTEST_TEST_FINGERPRINT)); \
+    static volatile bool __mstest_test_case_node_##fixture##_##testcase##_ = mstest::detail::TestList::register_test(&__mstest_test_case_node_##fixture##_##testcase)
+#endif
+
 #define MSTEST(fixture, testcase) \
     class __mstest_##fixture##_##testcase : public mstest::Test \
     { \
         void execute() override;\
     }; \
-    static __mstest_##fixture##_##testcase __mstest_##fixture##_##testcase##_instance; \
-    static mstest::detail::TestCaseNode __mstest_test_case_node_##fixture##_##testcase(&__mstest_##fixture##_##testcase##_instance, #fixture, #testcase); \
-    static volatile bool __mstest_test_case_node_##fixture##_##testcase##_ = mstest::detail::TestList::register_test(&__mstest_test_case_node_##fixture##_##testcase); \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
     void __mstest_##fixture##_##testcase::execute()
 
 #define MSTEST_F(fixture, testcase) \
@@ -43,7 +68,120 @@
     { \
         void execute() override;\
     }; \
-    static __mstest_##fixture##_##testcase __mstest_##fixture##_##testcase##_instance; \
-    static mstest::detail::TestCaseNode __mstest_test_case_node_##fixture##_##testcase(&__mstest_##fixture##_##testcase##_instance, #fixture, #testcase); \
-    static volatile bool __mstest_test_case_node_##fixture##_##testcase##_ = mstest::detail::TestList::register_test(&__mstest_test_case_node_##fixture##_##testcase); \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
     void __mstest_##fixture##_##testcase::execute()
+
+/* Body is a single iteration, it is called in calibrated batches */
+#define MSTEST_BENCH(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public mstest::Test \
+    { \
+    public: \
+        void iteration(); \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_benchmark([this] { iteration(); }); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    void __mstest_##fixture##_##testcase::iteration()
+
+/* Benchmark using fixture, setup() and teardown() run once around all batches */
+#define MSTEST_BENCH_F(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public fixture \
+    { \
+    public: \
+        void iteration(); \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_benchmark([this] { iteration(); }); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    void __mstest_##fixture##_##testcase::iteration()
+
+/* Body is one case, it draws its inputs with draw(generator) and is run
+ * for many generated cases. Failures are kept for the shrunk case only. */
+#define MSTEST_PROPERTY(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public mstest::Test \
+    { \
+    public: \
+        void property(); \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_property(mstest::detail::test_id(#fixture, #testcase), \
+                &mstest::detail::call_property<__mstest_##fixture##_##testcase>, this); \
+        } \
+        template <class Generator> \
+        static auto draw(const Generator& generator) \
+        { \
+            return mstest::draw(generator); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    void __mstest_##fixture##_##testcase::property()
+
+/* Property using fixture, setup() and teardown() run once around all cases */
+#define MSTEST_PROPERTY_F(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public fixture \
+    { \
+    public: \
+        void property(); \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_property(mstest::detail::test_id(#fixture, #testcase), \
+                &mstest::detail::call_property<__mstest_##fixture##_##testcase>, this); \
+        } \
+        template <class Generator> \
+        static auto draw(const Generator& generator) \
+        { \
+            return mstest::draw(generator); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    void __mstest_##fixture##_##testcase::property()
+
+/* Body is a coroutine returning mstest::Task, it may co_await events,
+ * timers and other tasks on a virtual clock. Host runners interleave
+ * consecutive async tests of one suite on one thread, so they can signal
+ * each other through shared events. --isolate and targets run each on its
+ * own. A failed assert_* ends every coroutine of the test. */
+#define MSTEST_ASYNC(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public mstest::Test \
+    { \
+    public: \
+        mstest::Task body(); \
+        static mstest::Task mstest_async_body(mstest::Test* test) \
+        { \
+            return static_cast<__mstest_##fixture##_##testcase*>(test)->body(); \
+        } \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_async(body()); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    mstest::Task __mstest_##fixture##_##testcase::body()
+
+/* Async test using fixture, setup() and teardown() run around the body */
+#define MSTEST_ASYNC_F(fixture, testcase) \
+    class __mstest_##fixture##_##testcase final : public fixture \
+    { \
+    public: \
+        mstest::Task body(); \
+        static mstest::Task mstest_async_body(mstest::Test* test) \
+        { \
+            return static_cast<__mstest_##fixture##_##testcase*>(test)->body(); \
+        } \
+    private: \
+        void execute() override \
+        { \
+            mstest::detail::run_async(body()); \
+        } \
+    }; \
+    MSTEST_DETAIL_REGISTER(fixture, testcase); \
+    mstest::Task __mstest_##fixture##_##testcase::body()
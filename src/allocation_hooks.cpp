@@ -0,0 +1,383 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Heap hooks of MSTEST_ALLOCATION_TRACKING. The C allocation functions
+ * are wrapped with ld --wrap, operator new and delete are replaced and go
+ * through the wrapped malloc and free. */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+#include "mstest/allocations.hpp"
+#include "mstest/detail/context.hpp"
+
+extern "C"
+{
+void* __real_malloc(std::size_t size);
+void* __real_calloc(std::size_t count, std::size_t size);
+void* __real_realloc(void* pointer, std::size_t size);
+void* __real_aligned_alloc(std::size_t alignment, std::size_t size);
+int __real_posix_memalign(void** pointer, std::size_t alignment, std::size_t size);
+void __real_free(void* pointer);
+}
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+static_assert((MSTEST_ALLOCATION_BLOCKS & (MSTEST_ALLOCATION_BLOCKS - 1)) == 0, "MSTEST_ALLOCATION_BLOCKS must be a power of two");
+
+constexpr std::size_t block_mask = MSTEST_ALLOCATION_BLOCKS - 1;
+
+struct Block
+{
+    void* pointer;
+    const void* owner;
+};
+
+struct Tracker
+{
+    bool enabled = false;
+    const void* owner = nullptr;
+    AllocationStats stats;
+    /* Blocks allocated while tracking and not freed yet, open addressed
+     * with linear probing */
+    Block blocks[MSTEST_ALLOCATION_BLOCKS] = {};
+    std::size_t block_count = 0;
+    /* Allocations the table had no room for */
+    std::uint32_t untracked = 0;
+};
+
+MSTEST_THREAD_LOCAL Tracker tracker;
+
+std::size_t home_slot(const void* pointer)
+{
+    const std::uint64_t bits = reinterpret_cast<std::uintptr_t>(pointer) >> 4;
+    return static_cast<std::size_t>((bits * 0x9E3779B97F4A7C15ull) >> 32) & block_mask;
+}
+
+bool remember(void* pointer)
+{
+    if (tracker.block_count >= MSTEST_ALLOCATION_BLOCKS / 4 * 3)
+    {
+        return false;
+    }
+    std::size_t slot = home_slot(pointer);
+    while (tracker.blocks[slot].pointer != nullptr)
+    {
+        slot = (slot + 1) & block_mask;
+    }
+    tracker.blocks[slot] = Block{pointer, tracker.owner};
+    ++tracker.block_count;
+    return true;
+}
+
+/* Drops pointer from the table, true when the current owner allocated it */
+bool forget(void* pointer)
+{
+    Block* const blocks = tracker.blocks;
+    std::size_t slot = home_slot(pointer);
+    while (blocks[slot].pointer != pointer)
+    {
+        if (blocks[slot].pointer == nullptr)
+        {
+            return false;
+        }
+        slot = (slot + 1) & block_mask;
+    }
+    const bool own = blocks[slot].owner == tracker.owner;
+
+    /* Moves later blocks of the probe sequence back into the hole */
+    std::size_t hole = slot;
+    for (std::size_t next = (hole + 1) & block_mask; blocks[next].pointer != nullptr; next = (next + 1) & block_mask)
+    {
+        const std::size_t home = home_slot(blocks[next].pointer);
+        if (((next - home) & block_mask) >= ((next - hole) & block_mask))
+        {
+            blocks[hole] = blocks[next];
+            hole = next;
+        }
+    }
+    blocks[hole].pointer = nullptr;
+    --tracker.block_count;
+    return own;
+}
+
+void allocated(void* pointer)
+{
+    if (pointer == nullptr || !tracker.enabled)
+    {
+        return;
+    }
+    if (!remember(pointer))
+    {
+        ++tracker.untracked;
+    }
+    const std::size_t size = malloc_usable_size(pointer);
+    AllocationStats& stats = tracker.stats;
+    ++stats.allocations;
+    stats.bytes += size;
+    stats.live_bytes += static_cast<std::int64_t>(size);
+    if (stats.live_bytes > stats.peak_bytes)
+    {
+        stats.peak_bytes = stats.live_bytes;
+    }
+}
+
+void freed(void* pointer, std::size_t size)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+    /* Forgotten even when not tracking, the address may come back */
+    const bool own = tracker.block_count != 0 && forget(pointer);
+    if (!tracker.enabled)
+    {
+        return;
+    }
+    if (!own)
+    {
+        if (tracker.untracked == 0)
+        {
+            return;
+        }
+        --tracker.untracked;
+    }
+    ++tracker.stats.frees;
+    tracker.stats.live_bytes -= static_cast<std::int64_t>(size);
+}
+
+void* allocate(std::size_t size)
+{
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr)
+    {
+#if defined(__cpp_exceptions)
+        throw std::bad_alloc();
+#else
+        std::abort();
+#endif
+    }
+    return pointer;
+}
+
+void* allocate(std::size_t size, std::align_val_t alignment)
+{
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    /* aligned_alloc wants a multiple of the alignment */
+    void* pointer = aligned_alloc(align, (size + align - 1) / align * align);
+    if (pointer == nullptr)
+    {
+#if defined(__cpp_exceptions)
+        throw std::bad_alloc();
+#else
+        std::abort();
+#endif
+    }
+    return pointer;
+}
+
+} // namespace
+
+const AllocationStats& thread_allocations()
+{
+    return tracker.stats;
+}
+
+void start_allocation_tracking(const void* owner)
+{
+    if (owner == nullptr)
+    {
+        if (tracker.block_count != 0)
+        {
+            for (Block& block : tracker.blocks)
+            {
+                block.pointer = nullptr;
+            }
+            tracker.block_count = 0;
+        }
+        tracker.untracked = 0;
+    }
+    tracker.owner = owner;
+    tracker.stats = AllocationStats{};
+    tracker.enabled = true;
+}
+
+AllocationStats stop_allocation_tracking()
+{
+    tracker.enabled = false;
+    return tracker.stats;
+}
+
+} // namespace detail
+} // namespace mstest
+
+using mstest::detail::allocated;
+using mstest::detail::freed;
+
+extern "C"
+{
+
+void* __wrap_malloc(std::size_t size)
+{
+    void* pointer = __real_malloc(size);
+    allocated(pointer);
+    return pointer;
+}
+
+void* __wrap_calloc(std::size_t count, std::size_t size)
+{
+    void* pointer = __real_calloc(count, size);
+    allocated(pointer);
+    return pointer;
+}
+
+/* Counted as a free and a new allocation, it may move the block */
+void* __wrap_realloc(void* pointer, std::size_t size)
+{
+    const std::size_t old_size = pointer != nullptr ? malloc_usable_size(pointer) : 0;
+    void* moved = __real_realloc(pointer, size);
+    if (moved != nullptr || size == 0)
+    {
+        freed(pointer, old_size);
+        allocated(moved);
+    }
+    return moved;
+}
+
+void* __wrap_aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    void* pointer = __real_aligned_alloc(alignment, size);
+    allocated(pointer);
+    return pointer;
+}
+
+int __wrap_posix_memalign(void** pointer, std::size_t alignment, std::size_t size)
+{
+    const int result = __real_posix_memalign(pointer, alignment, size);
+    if (result == 0)
+    {
+        allocated(*pointer);
+    }
+    return result;
+}
+
+void __wrap_free(void* pointer)
+{
+    if (pointer != nullptr)
+    {
+        freed(pointer, malloc_usable_size(pointer));
+    }
+    __real_free(pointer);
+}
+
+} // extern "C"
+
+void* operator new(std::size_t size)
+{
+    return mstest::detail::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return mstest::detail::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return mstest::detail::allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return mstest::detail::allocate(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free(pointer);
+}
@@ -0,0 +1,413 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+
+#if defined(MSTEST_HOST)
+#include <new>
+#include <string_view>
+#include <vector>
+#endif
+
+#include "mstest/allocations.hpp"
+#include "mstest/async.hpp"
+#include "mstest/detail/clock.hpp"
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/perf_counters.hpp"
+#include "mstest/detail/testcase_node.hpp"
+
+#include "runner_internal.hpp"
+
+#if defined(MSTEST_HOST)
+#include "watchdog.hpp"
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+namespace
+{
+
+/* Adds the heap use of one stretch of a test to what it used before */
+void add_heap(AllocationStats& total, const AllocationStats& stretch)
+{
+    total.peak_bytes = std::max(total.peak_bytes, total.live_bytes + stretch.peak_bytes);
+    total.allocations += stretch.allocations;
+    total.frees += stretch.frees;
+    total.bytes += stretch.bytes;
+    total.live_bytes += stretch.live_bytes;
+}
+
+} // namespace
+
+void Scheduler::run(AsyncTest* tests, std::size_t count, bool grouped)
+{
+    grouped_ = grouped;
+    now_ = 0;
+    pending_ = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (tests[i].root != nullptr)
+        {
+            tests[i].root->owner = &tests[i];
+            ready_.push_back(tests[i].root->start);
+            ++pending_;
+        }
+    }
+
+    while (pending_ != 0)
+    {
+        if (Waiter* waiter = ready_.front())
+        {
+            ready_.remove(*waiter);
+            resume(*waiter);
+            continue;
+        }
+
+        Waiter* timer = timers_.front();
+        if (timer == nullptr || timer->deadline > MSTEST_ASYNC_TIME_LIMIT_NS)
+        {
+            /* Nothing can wake the roots left, or not in time */
+            const Expectation kind = timer == nullptr ? Expectation::async_deadlock : Expectation::async_time_limit;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (tests[i].root != nullptr)
+                {
+                    fail(tests[i], kind);
+                }
+            }
+            break;
+        }
+
+        now_ = timer->deadline;
+        while ((timer = timers_.front()) != nullptr && timer->deadline <= now_)
+        {
+            timers_.remove(*timer);
+            ready_.push_back(*timer);
+        }
+    }
+
+}
+
+void Scheduler::sleep(Waiter& waiter)
+{
+    Waiter* position = timers_.front();
+    while (position != nullptr && position->deadline <= waiter.deadline)
+    {
+        position = position->next;
+    }
+    timers_.insert(waiter, position);
+}
+
+void Scheduler::wake(const Event& event)
+{
+    Waiter* waiter = waiting_.front();
+    while (waiter != nullptr)
+    {
+        Waiter* const next = waiter->next;
+        if (waiter->event == &event)
+        {
+            waiting_.remove(*waiter);
+            ready_.push_back(*waiter);
+        }
+        waiter = next;
+    }
+}
+
+void Scheduler::spawn(TaskPromise& task)
+{
+    AsyncTest* const test = running_ != nullptr ? running_->owner : nullptr;
+    if (test == nullptr)
+    {
+        /* Nothing runs that it could belong to */
+        task.destroy();
+        return;
+    }
+    task.owner = test;
+    task.next_spawned = test->spawned;
+    if (test->spawned != nullptr)
+    {
+        test->spawned->previous_spawned = &task;
+    }
+    test->spawned = &task;
+    ready_.push_back(task.start);
+}
+
+void Scheduler::resume(Waiter& waiter)
+{
+    TaskPromise& task = *waiter.task;
+    AsyncTest& test = *task.owner;
+    enter(test);
+
+    Context& context = Context::get();
+    std::jmp_buf escape;
+    std::jmp_buf* const outer = context.escape(&escape);
+    const std::uint64_t start = Clock::now();
+    running_ = &task;
+    finished_ = nullptr;
+    if (setjmp(escape) == 0)
+    {
+        std::coroutine_handle<TaskPromise>::from_promise(task).resume();
+        if (finished_ != nullptr && finished_ == test.root)
+        {
+            end_root(test);
+        }
+        else if (finished_ != nullptr)
+        {
+            TaskPromise& spawned = *finished_;
+            (spawned.previous_spawned != nullptr ? spawned.previous_spawned->next_spawned : test.spawned) = spawned.next_spawned;
+            if (spawned.next_spawned != nullptr)
+            {
+                spawned.next_spawned->previous_spawned = spawned.previous_spawned;
+            }
+            spawned.destroy();
+        }
+    }
+    else
+    {
+        /* An assert_* left the running coroutine in the middle, the whole
+         * test ends with it */
+        running_->stopped = true;
+        if (test.root != nullptr)
+        {
+            end_root(test);
+        }
+        else
+        {
+            end_spawned(test);
+        }
+    }
+    context.escape(outer);
+    running_ = nullptr;
+    finished_ = nullptr;
+    test.execute_ns += Clock::to_ns(Clock::now() - start);
+    leave(test);
+}
+
+void Scheduler::enter(AsyncTest& test)
+{
+    Context& context = Context::get();
+    context.current_test(test.test);
+    context.redirect(test.record);
+#if defined(MSTEST_HOST)
+    if (grouped_)
+    {
+        watchdog_arm(*test.node);
+        start_allocation_tracking(test.node);
+        start_counters();
+    }
+#endif
+}
+
+void Scheduler::leave([[maybe_unused]] AsyncTest& test)
+{
+#if defined(MSTEST_HOST)
+    if (grouped_)
+    {
+        test.counters += stop_counters();
+        add_heap(test.heap, stop_allocation_tracking());
+        watchdog_disarm();
+    }
+#endif
+}
+
+/* The body is done, so are the tasks it spawned */
+void Scheduler::end_root(AsyncTest& test)
+{
+    test.root->destroy();
+    test.root = nullptr;
+    --pending_;
+    end_spawned(test);
+}
+
+void Scheduler::end_spawned(AsyncTest& test)
+{
+    while (test.spawned != nullptr)
+    {
+        TaskPromise* const task = test.spawned;
+        test.spawned = task->next_spawned;
+        task->destroy();
+    }
+}
+
+void Scheduler::fail(AsyncTest& test, Expectation kind)
+{
+    enter(test);
+    /* Reported where the body itself waits, not where its helpers do */
+    const TaskPromise* leaf = test.root;
+    while (leaf->child != nullptr)
+    {
+        leaf = leaf->child;
+    }
+    const Waiter* const waiter = leaf->waiting;
+    const char* const file = waiter != nullptr ? waiter->file : "";
+    const std::uint_least32_t line = waiter != nullptr ? waiter->line : 0;
+
+    test.test->fail();
+    FailureArena& failures = Context::get().failures();
+    if (kind == Expectation::async_time_limit)
+    {
+        failures.record(kind, file, line, static_cast<std::uint64_t>(MSTEST_ASYNC_TIME_LIMIT_NS));
+    }
+    else
+    {
+        failures.record(kind, file, line);
+    }
+    end_root(test);
+    leave(test);
+}
+
+void run_async(Task body)
+{
+    AsyncTest test;
+    test.test = Context::get().current_test();
+    test.root = body.release();
+    Scheduler::get().run(&test, 1, false);
+}
+
+#if defined(MSTEST_HOST)
+namespace
+{
+
+/* Runs setup() or teardown(), false when an assert_* ended it */
+bool run_phase(mstest::Test& test, void (mstest::Test::*phase)())
+{
+    Context& context = Context::get();
+    std::jmp_buf escape;
+    std::jmp_buf* const volatile outer = context.escape(&escape);
+    if (setjmp(escape) != 0)
+    {
+        context.escape(outer);
+        return false;
+    }
+    (test.*phase)();
+    context.escape(outer);
+    return true;
+}
+
+} // namespace
+
+std::size_t async_group_end(const std::vector<TestCaseNode*>& tests, std::size_t begin)
+{
+    std::size_t end = begin + 1;
+    /* Repeated tests run one at a time */
+    if (tests[begin]->async_body() == nullptr || repeating(run_options()))
+    {
+        return end;
+    }
+    const std::string_view suite(tests[begin]->suite());
+    while (end < tests.size() && tests[end]->async_body() != nullptr && std::string_view(tests[end]->suite()) == suite)
+    {
+        ++end;
+    }
+    return end;
+}
+
+void run_async_group(TestCaseNode* const* tests, std::size_t count, TestRecord* records, bool last_in_suite)
+{
+    struct Member
+    {
+        void* storage;
+        std::uint64_t setup_ns;
+    };
+
+    std::vector<AsyncTest> group(count);
+    std::vector<Member> members(count);
+    Context& context = Context::get();
+
+    /* Hooks are charged to the first and the last test of the group */
+    context.redirect(&records[0]);
+    const bool suite_set_up = enter_suite(*tests[0]);
+
+    /* Every fixture is set up before any body runs */
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        TestCaseNode& node = *tests[i];
+        AsyncTest& test = group[i];
+        test.node = &node;
+        test.record = &records[i];
+        /* Fixture storage belongs to the runner, not to the test */
+        members[i].storage = ::operator new(node.fixture_size(), std::align_val_t(node.fixture_align()));
+
+        context.redirect(test.record);
+        watchdog_arm(node);
+        start_allocation_tracking(&node);
+        const std::uint64_t start = Clock::now();
+        test.test = node.construct(members[i].storage);
+        context.current_test(test.test);
+        if (run_phase(*test.test, &mstest::Test::setup))
+        {
+            test.root = node.async_body()(test.test).release();
+        }
+        members[i].setup_ns = Clock::to_ns(Clock::now() - start);
+        add_heap(test.heap, stop_allocation_tracking());
+        watchdog_disarm();
+    }
+
+    Scheduler::get().run(group.data(), count, true);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        TestCaseNode& node = *tests[i];
+        AsyncTest& test = group[i];
+
+        context.redirect(test.record);
+        context.current_test(test.test);
+        watchdog_arm(node);
+        start_allocation_tracking(&node);
+        const std::uint64_t start = Clock::now();
+        run_phase(*test.test, &mstest::Test::teardown);
+        const bool passed = test.test->is_passed();
+        test.test->~Test();
+        context.current_test(nullptr);
+        const std::uint64_t teardown_ns = Clock::to_ns(Clock::now() - start);
+        add_heap(test.heap, stop_allocation_tracking());
+        watchdog_disarm();
+        ::operator delete(members[i].storage, std::align_val_t(node.fixture_align()));
+        bool suite_passed = i != 0 || suite_set_up;
+        if (i + 1 == count && last_in_suite)
+        {
+            suite_passed = leave_suite() && suite_passed;
+        }
+
+        TestResult result = node.finish(members[i].setup_ns, test.execute_ns, teardown_ns, passed);
+        result.heap = test.heap;
+        result.counters = test.counters;
+        /* The fixture is destroyed by now, anything still allocated leaked */
+        if (result.heap.leaked_blocks() != 0 || !suite_passed)
+        {
+            result.passed = false;
+        }
+        node.result(result);
+    }
+    context.redirect(nullptr);
+}
+#endif
+
+} // namespace detail
+} // namespace mstest
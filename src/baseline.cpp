@@ -0,0 +1,151 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+#include "baseline.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* First line of the file, the number is bumped when the format changes */
+constexpr const char* baseline_header = "mstest baseline 1\n";
+
+bool by_id(const Baseline::Entry& entry, std::uint32_t id)
+{
+    return entry.id < id;
+}
+
+} // namespace
+
+double Baseline::Entry::median_ns() const
+{
+    const std::size_t size = std::min<std::size_t>(count, MSTEST_BASELINE_RUNS);
+    if (size == 0)
+    {
+        return 0;
+    }
+    double sorted[MSTEST_BASELINE_RUNS];
+    std::copy(runs_ns, runs_ns + size, sorted);
+    std::sort(sorted, sorted + size);
+    return size % 2 ? sorted[size / 2] : (sorted[size / 2 - 1] + sorted[size / 2]) / 2;
+}
+
+void Baseline::load(const char* path)
+{
+    entries_.clear();
+    FILE* file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    char header[32];
+    if (fgets(header, sizeof(header), file) != nullptr && std::string(header) == baseline_header)
+    {
+        /* id, number of runs, then the timing of every run */
+        Entry entry;
+        while (fscanf(file, "%" SCNx32 " %" SCNu32, &entry.id, &entry.count) == 2)
+        {
+            if (entry.count == 0 || entry.count > MSTEST_BASELINE_RUNS)
+            {
+                break;
+            }
+            std::uint32_t read = 0;
+            while (read < entry.count && fscanf(file, "%lf", &entry.runs_ns[read]) == 1)
+            {
+                ++read;
+            }
+            if (read != entry.count)
+            {
+                break;
+            }
+            entries_.push_back(entry);
+        }
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    }
+    fclose(file);
+}
+
+bool Baseline::save(const char* path) const
+{
+    /* Readers never see a half written baseline */
+    const std::string temporary = std::string(path) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = fputs(baseline_header, file) >= 0;
+    for (const Entry& entry : entries_)
+    {
+        written = written && fprintf(file, "%08" PRIx32 " %" PRIu32, entry.id, entry.count) > 0;
+        for (std::uint32_t i = 0; i < entry.count; ++i)
+        {
+            written = written && fprintf(file, " %.1f", entry.runs_ns[i]) > 0;
+        }
+        written = written && fputc('\n', file) != EOF;
+    }
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+const Baseline::Entry* Baseline::find(const TestCaseNode& test) const
+{
+    const std::uint32_t id = test.id();
+    const auto entry = std::lower_bound(entries_.begin(), entries_.end(), id, by_id);
+    return entry != entries_.end() && entry->id == id ? &*entry : nullptr;
+}
+
+void Baseline::update(const TestCaseNode& test, const TestRecord& record)
+{
+    const std::uint32_t id = test.id();
+    auto entry = std::lower_bound(entries_.begin(), entries_.end(), id, by_id);
+    if (entry == entries_.end() || entry->id != id)
+    {
+        entry = entries_.insert(entry, Entry{id, 0, {}});
+    }
+    if (entry->count == MSTEST_BASELINE_RUNS)
+    {
+        std::copy(entry->runs_ns + 1, entry->runs_ns + MSTEST_BASELINE_RUNS, entry->runs_ns);
+        --entry->count;
+    }
+    entry->runs_ns[entry->count++] = timing_ns(test, record);
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,95 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/testcase_node.hpp"
+
+/* Timings kept per test, the baseline of a test is their median */
+#ifndef MSTEST_BASELINE_RUNS
+#define MSTEST_BASELINE_RUNS 5
+#endif
+
+/* Tests faster than that are not compared against their baseline, their
+ * time is mostly scheduling noise. Benchmarks are always compared. */
+#ifndef MSTEST_BASELINE_MIN_NS
+#define MSTEST_BASELINE_MIN_NS 1000000
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Timings of previous runs that later runs are held to, kept in a small
+ * text file next to the result cache. A benchmark is timed by its median
+ * nanoseconds per iteration, a repeated test by its median run and any
+ * other test by its execute phase. */
+class Baseline
+{
+public:
+    struct Entry
+    {
+        std::uint32_t id;
+        std::uint32_t count;
+        /* Oldest first */
+        double runs_ns[MSTEST_BASELINE_RUNS];
+
+        double median_ns() const;
+    };
+
+    /* A missing or malformed file leaves the baseline empty */
+    void load(const char* path);
+    /* Replaces the file in one rename, false when it cannot be written */
+    bool save(const char* path) const;
+
+    const Entry* find(const TestCaseNode& test) const;
+    /* Adds the timing of the last execution of test, dropping the oldest */
+    void update(const TestCaseNode& test, const TestRecord& record);
+
+    /* What a run of test is compared with its baseline by */
+    static double timing_ns(const TestCaseNode& test, const TestRecord& record)
+    {
+        if (record.benchmark.iterations != 0)
+        {
+            return record.benchmark.median_ns;
+        }
+        if (record.repeat.runs != 0)
+        {
+            return static_cast<double>(record.repeat.p50_ns);
+        }
+        return static_cast<double>(test.result().execute_ns);
+    }
+
+private:
+    /* Sorted by id */
+    std::vector<Entry> entries_;
+};
+
+} // namespace detail
+} // namespace mstest
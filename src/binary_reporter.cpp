@@ -0,0 +1,198 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "mstest/detail/binary_protocol.hpp"
+#include "mstest/detail/hash.hpp"
+#include "mstest/reporter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* Builds one frame on the stack and writes it out when destroyed */
+class FrameWriter
+{
+public:
+    FrameWriter(Output& output, binary::Frame type)
+        : output_(output)
+        , type_(type)
+    {
+    }
+
+    ~FrameWriter()
+    {
+        std::uint8_t header[1 + binary::max_varint_size];
+        header[0] = static_cast<std::uint8_t>(type_);
+        const std::size_t header_size = 1 + binary::put_varint(header + 1, size_);
+        output_.write(header, header_size);
+        output_.write(payload_, size_);
+    }
+
+    FrameWriter& varint(std::uint64_t value)
+    {
+        if (size_ + binary::max_varint_size <= sizeof(payload_))
+        {
+            size_ += binary::put_varint(payload_ + size_, value);
+        }
+        return *this;
+    }
+
+    FrameWriter& bytes(const void* data, std::size_t size)
+    {
+        if (size > sizeof(payload_) - size_)
+        {
+            size = sizeof(payload_) - size_;
+        }
+        memcpy(payload_ + size_, data, size);
+        size_ += size;
+        return *this;
+    }
+
+private:
+    Output& output_;
+    binary::Frame type_;
+    std::size_t size_ = 0;
+    std::uint8_t payload_[64 + 2 * (MSTEST_OPERAND_SIZE * 2 + 2 + binary::max_varint_size)];
+};
+
+std::uint64_t to_ps(double ns)
+{
+    return static_cast<std::uint64_t>(ns * 1000 + 0.5);
+}
+
+class BinaryReporter : public Reporter
+{
+public:
+    void run_start(Output& output, const Options&, std::size_t tests) override
+    {
+        output.write(binary::magic, sizeof(binary::magic));
+        FrameWriter(output, binary::Frame::start).varint(tests);
+    }
+
+    void suite_start(Output& output, const char* suite) override
+    {
+        FrameWriter(output, binary::Frame::suite).varint(fnv1a(suite));
+    }
+
+    void failure(Output& output, const TestCase& test, const Failure& failure) override
+    {
+        FrameWriter frame(output, binary::Frame::failure);
+        frame.varint(test.id()).varint(fnv1a(failure.file)).varint(failure.line);
+        frame.varint(static_cast<std::uint8_t>(failure.kind)).varint(failure.operand_count);
+        for (std::size_t i = 0; i < failure.operand_count; ++i)
+        {
+            const OperandRecord& operand = failure.operands[i];
+            if (operand.type == OperandType::text || operand.type == OperandType::custom)
+            {
+                char text[MSTEST_OPERAND_SIZE * 2];
+                operand.print(operand.data, text, sizeof(text));
+                const std::size_t size = strlen(text);
+                frame.varint(static_cast<std::uint8_t>(OperandType::text)).varint(size).bytes(text, size);
+            }
+            else
+            {
+                frame.varint(static_cast<std::uint8_t>(operand.type)).varint(operand.size).bytes(operand.data, operand.size);
+            }
+        }
+    }
+
+    void note(Output& output, const TestCase& test, const char* title, const char* text) override
+    {
+        FrameWriter frame(output, binary::Frame::note);
+        frame.varint(test.id()).bytes(title, strlen(title) + 1).bytes(text, strlen(text));
+    }
+
+    void test_end(Output& output, const TestCase& test, const TestRecord& record) override
+    {
+        if (record.failures.dropped() != 0)
+        {
+            FrameWriter(output, binary::Frame::dropped).varint(test.id()).varint(record.failures.dropped());
+        }
+
+        const BenchmarkStats& stats = record.benchmark;
+        if (stats.iterations != 0)
+        {
+            FrameWriter(output, binary::Frame::benchmark).varint(test.id()).varint(stats.iterations).varint(stats.samples)
+                .varint(to_ps(stats.min_ns)).varint(to_ps(stats.median_ns)).varint(to_ps(stats.p99_ns)).varint(to_ps(stats.mean_ns));
+        }
+
+        const PropertyStats& property = record.property;
+        if (property.cases != 0)
+        {
+            FrameWriter(output, binary::Frame::property).varint(test.id()).varint(property.seed).varint(property.cases)
+                .varint(property.shrinks).varint(property.duration_ns).varint(property.falsified ? 1 : 0)
+                .bytes(property.example, strlen(property.example));
+        }
+
+        const RepeatStats& repeat = record.repeat;
+        if (repeat.runs != 0)
+        {
+            FrameWriter(output, binary::Frame::repeat).varint(test.id()).varint(repeat.runs).varint(repeat.failures)
+                .varint(repeat.p50_ns).varint(repeat.p99_ns).varint(repeat.max_ns);
+        }
+
+        const TestResult& result = test.result();
+        std::uint8_t flags = 0;
+        flags |= result.passed ? binary::passed : 0;
+        flags |= result.timed_out ? binary::timed_out : 0;
+        const AllocationStats& heap = result.heap;
+        FrameWriter frame(output, binary::Frame::result);
+        frame.varint(test.id()).varint(flags).varint(result.budget_ms)
+            .varint(result.setup_ns).varint(result.execute_ns).varint(result.teardown_ns)
+            .varint(heap.allocations).varint(heap.frees).varint(heap.bytes)
+            .varint(static_cast<std::uint64_t>(heap.peak_bytes)).varint(static_cast<std::uint64_t>(heap.live_bytes > 0 ? heap.live_bytes : 0));
+        /* Left out without counters, the decoder reads none as available */
+        if (result.counters.available != 0)
+        {
+            frame.varint(result.counters.available);
+            for (std::uint64_t count : result.counters.counts)
+            {
+                frame.varint(count);
+            }
+        }
+    }
+
+    void run_end(Output& output, const Summary& summary) override
+    {
+        FrameWriter(output, binary::Frame::summary).varint(static_cast<std::uint64_t>(summary.executed))
+            .varint(static_cast<std::uint64_t>(summary.passed)).varint(static_cast<std::uint64_t>(summary.skipped));
+    }
+};
+
+} // namespace
+} // namespace detail
+
+Reporter& binary_reporter()
+{
+    static detail::BinaryReporter reporter;
+    return reporter;
+}
+
+} // namespace mstest
@@ -0,0 +1,257 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "mstest/span_expectations.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/* Near compares run a vector block at a time and only scan blocks with a
+ * mismatch element by element, the common passing case stays a few
+ * instructions per block. AVX is picked at runtime on hosts, targets use
+ * the scalar loop. */
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+template <class T>
+bool is_near(T a, T b, T abs_tolerance, T rel_tolerance)
+{
+    if (a == b)
+    {
+        return true;
+    }
+    const T difference = std::fabs(a - b);
+    const T magnitude = std::fmax(std::fabs(a), std::fabs(b));
+    return difference < std::numeric_limits<T>::infinity()
+        && (difference <= abs_tolerance || difference <= rel_tolerance * magnitude);
+}
+
+template <class T>
+void scan_near(const T* a, const T* b, std::size_t begin, std::size_t end, T abs_tolerance, T rel_tolerance, MismatchSummary& summary)
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        if (!is_near(a[i], b[i], abs_tolerance, rel_tolerance))
+        {
+            summary.add(i, std::fabs(static_cast<double>(a[i]) - static_cast<double>(b[i])));
+        }
+    }
+}
+
+#if defined(__SSE2__)
+/* Returns where the vector blocks ended, the tail is left to the caller */
+std::size_t near_blocks_sse2(const float* a, const float* b, std::size_t size, float abs_tolerance, float rel_tolerance,
+    MismatchSummary& summary)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 abs_limit = _mm_set1_ps(abs_tolerance);
+    const __m128 rel_limit = _mm_set1_ps(rel_tolerance);
+    std::size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(a + i);
+        const __m128 y = _mm_loadu_ps(b + i);
+        const __m128 difference = _mm_andnot_ps(sign, _mm_sub_ps(x, y));
+        const __m128 magnitude = _mm_max_ps(_mm_andnot_ps(sign, x), _mm_andnot_ps(sign, y));
+        const __m128 within = _mm_or_ps(_mm_cmple_ps(difference, abs_limit), _mm_cmple_ps(difference, _mm_mul_ps(rel_limit, magnitude)));
+        const __m128 near = _mm_or_ps(_mm_cmpeq_ps(x, y), _mm_and_ps(within, _mm_cmplt_ps(difference, infinity)));
+        if (_mm_movemask_ps(near) != 0xf)
+        {
+            scan_near(a, b, i, i + 4, abs_tolerance, rel_tolerance, summary);
+        }
+    }
+    return i;
+}
+
+std::size_t near_blocks_sse2(const double* a, const double* b, std::size_t size, double abs_tolerance, double rel_tolerance,
+    MismatchSummary& summary)
+{
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d infinity = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    const __m128d abs_limit = _mm_set1_pd(abs_tolerance);
+    const __m128d rel_limit = _mm_set1_pd(rel_tolerance);
+    std::size_t i = 0;
+    for (; i + 2 <= size; i += 2)
+    {
+        const __m128d x = _mm_loadu_pd(a + i);
+        const __m128d y = _mm_loadu_pd(b + i);
+        const __m128d difference = _mm_andnot_pd(sign, _mm_sub_pd(x, y));
+        const __m128d magnitude = _mm_max_pd(_mm_andnot_pd(sign, x), _mm_andnot_pd(sign, y));
+        const __m128d within = _mm_or_pd(_mm_cmple_pd(difference, abs_limit), _mm_cmple_pd(difference, _mm_mul_pd(rel_limit, magnitude)));
+        const __m128d near = _mm_or_pd(_mm_cmpeq_pd(x, y), _mm_and_pd(within, _mm_cmplt_pd(difference, infinity)));
+        if (_mm_movemask_pd(near) != 0x3)
+        {
+            scan_near(a, b, i, i + 2, abs_tolerance, rel_tolerance, summary);
+        }
+    }
+    return i;
+}
+#endif
+
+#if defined(__x86_64__) && defined(MSTEST_HOST)
+[[gnu::target("avx")]] std::size_t near_blocks_avx(const float* a, const float* b, std::size_t size, float abs_tolerance,
+    float rel_tolerance, MismatchSummary& summary)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 abs_limit = _mm256_set1_ps(abs_tolerance);
+    const __m256 rel_limit = _mm256_set1_ps(rel_tolerance);
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(a + i);
+        const __m256 y = _mm256_loadu_ps(b + i);
+        const __m256 difference = _mm256_andnot_ps(sign, _mm256_sub_ps(x, y));
+        const __m256 magnitude = _mm256_max_ps(_mm256_andnot_ps(sign, x), _mm256_andnot_ps(sign, y));
+        const __m256 within = _mm256_or_ps(_mm256_cmp_ps(difference, abs_limit, _CMP_LE_OQ),
+            _mm256_cmp_ps(difference, _mm256_mul_ps(rel_limit, magnitude), _CMP_LE_OQ));
+        const __m256 near = _mm256_or_ps(_mm256_cmp_ps(x, y, _CMP_EQ_OQ), _mm256_and_ps(within, _mm256_cmp_ps(difference, infinity, _CMP_LT_OQ)));
+        if (_mm256_movemask_ps(near) != 0xff)
+        {
+            scan_near(a, b, i, i + 8, abs_tolerance, rel_tolerance, summary);
+        }
+    }
+    return i;
+}
+
+[[gnu::target("avx")]] std::size_t near_blocks_avx(const double* a, const double* b, std::size_t size, double abs_tolerance,
+    double rel_tolerance, MismatchSummary& summary)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d infinity = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d abs_limit = _mm256_set1_pd(abs_tolerance);
+    const __m256d rel_limit = _mm256_set1_pd(rel_tolerance);
+    std::size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        const __m256d x = _mm256_loadu_pd(a + i);
+        const __m256d y = _mm256_loadu_pd(b + i);
+        const __m256d difference = _mm256_andnot_pd(sign, _mm256_sub_pd(x, y));
+        const __m256d magnitude = _mm256_max_pd(_mm256_andnot_pd(sign, x), _mm256_andnot_pd(sign, y));
+        const __m256d within = _mm256_or_pd(_mm256_cmp_pd(difference, abs_limit, _CMP_LE_OQ),
+            _mm256_cmp_pd(difference, _mm256_mul_pd(rel_limit, magnitude), _CMP_LE_OQ));
+        const __m256d near = _mm256_or_pd(_mm256_cmp_pd(x, y, _CMP_EQ_OQ), _mm256_and_pd(within, _mm256_cmp_pd(difference, infinity, _CMP_LT_OQ)));
+        if (_mm256_movemask_pd(near) != 0xf)
+        {
+            scan_near(a, b, i, i + 4, abs_tolerance, rel_tolerance, summary);
+        }
+    }
+    return i;
+}
+
+bool has_avx()
+{
+    static const bool supported = __builtin_cpu_supports("avx");
+    return supported;
+}
+#endif
+
+template <class T>
+void near(const T* a, const T* b, std::size_t size, T abs_tolerance, T rel_tolerance, MismatchSummary& summary)
+{
+    std::size_t done = 0;
+#if defined(__x86_64__) && defined(MSTEST_HOST)
+    if (has_avx())
+    {
+        done = near_blocks_avx(a, b, size, abs_tolerance, rel_tolerance, summary);
+    }
+#endif
+#if defined(__SSE2__)
+    done += near_blocks_sse2(a + done, b + done, size - done, abs_tolerance, rel_tolerance, summary);
+#endif
+    scan_near(a, b, done, size, abs_tolerance, rel_tolerance, summary);
+}
+
+/* Maps the bits of a float to an unsigned integer that grows with its
+ * value, so the ulp distance is a subtraction */
+template <class Bits, class T>
+Bits ordered_bits(T value)
+{
+    Bits bits;
+    memcpy(&bits, &value, sizeof(bits));
+    constexpr Bits sign = Bits{1} << (sizeof(Bits) * 8 - 1);
+    return (bits & sign) != 0 ? ~bits : bits | sign;
+}
+
+template <class Bits, class T>
+void ulp(const T* a, const T* b, std::size_t size, std::uint64_t max_ulp, MismatchSummary& summary)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (a[i] == b[i])
+        {
+            continue;
+        }
+        if (a[i] != a[i] || b[i] != b[i])
+        {
+            summary.add(i, std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        const Bits x = ordered_bits<Bits>(a[i]);
+        const Bits y = ordered_bits<Bits>(b[i]);
+        const Bits distance = x > y ? x - y : y - x;
+        if (distance > max_ulp)
+        {
+            summary.add(i, static_cast<double>(distance));
+        }
+    }
+}
+
+} // namespace
+
+/* The blocks that failed are scanned in order, so the first mismatches
+ * recorded stay the first of the buffer */
+void compare_near(const float* a, const float* b, std::size_t size, double abs_tolerance, double rel_tolerance, MismatchSummary& summary)
+{
+    near(a, b, size, static_cast<float>(abs_tolerance), static_cast<float>(rel_tolerance), summary);
+}
+
+void compare_near(const double* a, const double* b, std::size_t size, double abs_tolerance, double rel_tolerance, MismatchSummary& summary)
+{
+    near(a, b, size, abs_tolerance, rel_tolerance, summary);
+}
+
+void compare_ulp(const float* a, const float* b, std::size_t size, std::uint64_t max_ulp, MismatchSummary& summary)
+{
+    ulp<std::uint32_t>(a, b, size, max_ulp, summary);
+}
+
+void compare_ulp(const double* a, const double* b, std::size_t size, std::uint64_t max_ulp, MismatchSummary& summary)
+{
+    ulp<std::uint64_t>(a, b, size, max_ulp, summary);
+}
+
+} // namespace detail
+} // namespace mstest
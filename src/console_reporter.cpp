@@ -0,0 +1,245 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+
+#include "mstest/detail/colors.hpp"
+#include "mstest/detail/perf_counters.hpp"
+#include "mstest/detail/symbols.hpp"
+#include "mstest/reporter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+double to_ms(std::uint64_t ns)
+{
+    return static_cast<double>(ns) / 1e6;
+}
+
+class ConsoleReporter : public Reporter
+{
+public:
+    void run_start(Output& output, const Options& options, std::size_t) override
+    {
+        quiet_ = options.quiet;
+        red_ = options.color ? color::red : "";
+        green_ = options.color ? color::green : "";
+        blue_ = options.color ? color::blue : "";
+        reset_ = options.color ? color::reset : "";
+        output.print("%s<---    Executing tests    --->%s\n", blue_, reset_);
+    }
+
+    void suite_start(Output& output, const char* suite) override
+    {
+        if (!quiet_)
+        {
+            output.print("%s -> Suite: %s%s\n", blue_, suite, reset_);
+        }
+    }
+
+    void failure(Output& output, const TestCase&, const Failure& failure) override
+    {
+        output.print("        Called from: %s:%d\n", failure.file, static_cast<int>(failure.line));
+        char message[256];
+        format_failure(failure, message, sizeof(message));
+        if (message[0] != '\0')
+        {
+            output.print("    %sAssertion failed:%s %s\n", red_, reset_, message);
+        }
+    }
+
+    void note(Output& output, const TestCase&, const char* title, const char* text) override
+    {
+        output.print("    %s%s:%s %s\n", red_, title, reset_, text);
+    }
+
+    void test_end(Output& output, const TestCase& test, const TestRecord& record) override
+    {
+        if (record.failures.dropped() != 0)
+        {
+            output.print("    ... and %d more failures\n", static_cast<int>(record.failures.dropped()));
+        }
+
+        const BenchmarkStats& stats = record.benchmark;
+        if (stats.iterations != 0)
+        {
+            output.print("    min %.1f ns, median %.1f ns, p99 %.1f ns, mean %.1f ns per iteration, %.0f iterations/s (%u x %llu)\n",
+                stats.min_ns, stats.median_ns, stats.p99_ns, stats.mean_ns, stats.iterations_per_second(),
+                static_cast<unsigned>(stats.samples), static_cast<unsigned long long>(stats.iterations / stats.samples));
+            print_counters(output, test.result().counters);
+        }
+
+        const PropertyStats& property = record.property;
+        if (property.cases != 0)
+        {
+            output.print("    %u cases, %.0f cases/s, seed %llu", static_cast<unsigned>(property.cases), property.cases_per_second(),
+                static_cast<unsigned long long>(property.seed));
+            if (property.falsified)
+            {
+                output.print(", shrunk %u times\n    %sCounterexample:%s %s\n", static_cast<unsigned>(property.shrinks), red_, reset_,
+                    property.example);
+            }
+            else
+            {
+                output.print("\n");
+            }
+        }
+
+        const RepeatStats& repeat = record.repeat;
+        if (repeat.runs != 0)
+        {
+            output.print("    %u runs, %u failed, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", static_cast<unsigned>(repeat.runs),
+                static_cast<unsigned>(repeat.failures), to_ms(repeat.p50_ns), to_ms(repeat.p99_ns), to_ms(repeat.max_ns));
+        }
+
+        const TestResult& result = test.result();
+        if (result.timed_out)
+        {
+            output.print("    %sTimeout:%s took %.3f ms, budget is %u ms\n", red_, reset_, to_ms(result.total_ns()),
+                static_cast<unsigned>(result.budget_ms));
+        }
+        if (result.heap.leaked_blocks() != 0)
+        {
+            output.print("    %sLeak:%s %u blocks, %lld bytes still allocated after teardown\n", red_, reset_,
+                static_cast<unsigned>(result.heap.leaked_blocks()), static_cast<long long>(result.heap.live_bytes));
+        }
+
+        if (!result.passed)
+        {
+            if (quiet_)
+            {
+                output.print("%s  x  %s.%s %10.3f ms%s\n", red_, test.suite(), test.testcase(), to_ms(result.total_ns()), reset_);
+            }
+            else
+            {
+                output.print("%s  x  %-50s %10.3f ms%s\n", red_, test.testcase(), to_ms(result.total_ns()), reset_);
+            }
+        }
+        else if (!quiet_)
+        {
+            output.print("%s  %s  %-50s %10.3f ms%s\n", green_, symbols::check_mark, test.testcase(), to_ms(result.total_ns()), reset_);
+        }
+    }
+
+    void run_end(Output& output, const Summary& summary) override
+    {
+        output.print("%s ----------------------------%s\n", blue_, reset_);
+        output.print("%s|%s Executed tests: %10d%s |%s\n", blue_, reset_, summary.executed, blue_, reset_);
+
+        const int failed_tests = summary.executed - summary.passed;
+        const char* failed_color = failed_tests != 0 ? red_ : green_;
+
+        output.print("%s|%s Passed tests  : %10d%s |%s\n", blue_, green_, summary.passed, blue_, reset_);
+        output.print("%s|%s Failed tests  : %10d%s |%s\n", blue_, failed_color, failed_tests, blue_, reset_);
+        if (summary.skipped != 0)
+        {
+            output.print("%s|%s Skipped tests : %10d%s |%s\n", blue_, reset_, summary.skipped, blue_, reset_);
+        }
+        output.print("%s ----------------------------%s\n", blue_, reset_);
+
+        if (summary.slowest_count != 0)
+        {
+            output.print("%s Slowest tests:%s\n", blue_, reset_);
+            for (std::size_t i = 0; i < summary.slowest_count; ++i)
+            {
+                const TestCase& test = *summary.slowest[i];
+                const TestResult& result = test.result();
+                output.print("  %10.3f ms  %s.%s (setup %.3f ms, execute %.3f ms, teardown %.3f ms)\n", to_ms(result.total_ns()),
+                    test.suite(), test.testcase(), to_ms(result.setup_ns), to_ms(result.execute_ns), to_ms(result.teardown_ns));
+                print_counters(output, result.counters);
+            }
+        }
+
+        if (summary.counters.available != 0)
+        {
+            char counters[160];
+            format_counters(summary.counters, counters, sizeof(counters));
+            output.print("%s Hardware counters:%s %s\n", blue_, reset_, counters);
+        }
+#if defined(MSTEST_PERF_COUNTERS)
+        else if (summary.executed != 0)
+        {
+            const char* error = counters_error();
+            output.print("%s Hardware counters:%s unavailable (%s)\n", blue_, reset_, error != nullptr ? error : "nothing counted");
+        }
+#endif
+
+        if (summary.unstable_count != 0)
+        {
+            output.print("%s Unstable tests:%s\n", blue_, reset_);
+            for (std::size_t i = 0; i < summary.unstable_count; ++i)
+            {
+                const Summary::Unstable& unstable = summary.unstable[i];
+                const RepeatStats& stats = unstable.stats;
+                output.print("  %9.2f%%    %s.%s (%u of %u runs failed, p50 %.3f ms, p99 %.3f ms, max %.3f ms)\n", stats.failure_rate() * 100,
+                    unstable.test->suite(), unstable.test->testcase(), static_cast<unsigned>(stats.failures), static_cast<unsigned>(stats.runs),
+                    to_ms(stats.p50_ns), to_ms(stats.p99_ns), to_ms(stats.max_ns));
+            }
+        }
+
+        if (summary.allocations != 0)
+        {
+            output.print("%s Heap allocations: %llu, most by:%s\n", blue_, static_cast<unsigned long long>(summary.allocations), reset_);
+            for (std::size_t i = 0; i < summary.most_allocating_count; ++i)
+            {
+                const TestCase& test = *summary.most_allocating[i];
+                const AllocationStats& heap = test.result().heap;
+                output.print("  %10u     %s.%s (%llu bytes, peak %lld bytes live)\n", static_cast<unsigned>(heap.allocations),
+                    test.suite(), test.testcase(), static_cast<unsigned long long>(heap.bytes), static_cast<long long>(heap.peak_bytes));
+            }
+        }
+    }
+
+private:
+    static void print_counters(Output& output, const CounterStats& counters)
+    {
+        if (counters.available != 0)
+        {
+            char text[160];
+            format_counters(counters, text, sizeof(text));
+            output.print("    %s\n", text);
+        }
+    }
+
+    bool quiet_ = false;
+    const char* red_ = color::red;
+    const char* green_ = color::green;
+    const char* blue_ = color::blue;
+    const char* reset_ = color::reset;
+};
+
+} // namespace
+} // namespace detail
+
+Reporter& console_reporter()
+{
+    static detail::ConsoleReporter reporter;
+    return reporter;
+}
+
+} // namespace mstest
@@ -0,0 +1,51 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <csetjmp>
+
+#include "mstest/expectations.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+void record_failure(Expectation kind, const std::source_location& location, const OperandReference* operands, std::size_t count)
+{
+    Context& context = Context::get();
+    context.current_test()->fail();
+    context.failures().record(kind, location.file_name(), location.line(), operands, count);
+}
+
+void abort_test()
+{
+    std::jmp_buf* const escape = Context::get().escape();
+    if (escape != nullptr)
+    {
+        std::longjmp(*escape, 1);
+    }
+}
+
+} // namespace detail
+} // namespace mstest
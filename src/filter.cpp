@@ -0,0 +1,257 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "filter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* "suite.testcase" without building the string */
+class TestName
+{
+public:
+    explicit TestName(const TestCaseNode& test)
+        : suite_(test.suite())
+        , testcase_(test.testcase())
+        , suite_size_(strlen(suite_))
+        , size_(suite_size_ + 1 + strlen(testcase_))
+    {
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    char operator[](std::size_t index) const
+    {
+        if (index < suite_size_)
+        {
+            return suite_[index];
+        }
+        return index == suite_size_ ? '.' : testcase_[index - suite_size_ - 1];
+    }
+
+private:
+    const char* suite_;
+    const char* testcase_;
+    std::size_t suite_size_;
+    std::size_t size_;
+};
+
+/* Backtracks to the last * only, which is enough for globs */
+template <class Name>
+bool glob(std::string_view pattern, const Name& name)
+{
+    constexpr std::size_t none = static_cast<std::size_t>(-1);
+    std::size_t p = 0;
+    std::size_t n = 0;
+    std::size_t star = none;
+    std::size_t star_n = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_n = n;
+        }
+        else if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if (star != none)
+        {
+            p = star + 1;
+            n = ++star_n;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+bool parse_id(std::string_view pattern, std::uint32_t& id)
+{
+    if (pattern.size() < 3 || pattern.size() > 10 || pattern[0] != '0' || (pattern[1] != 'x' && pattern[1] != 'X'))
+    {
+        return false;
+    }
+    id = 0;
+    for (const char c : pattern.substr(2))
+    {
+        std::uint32_t digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = static_cast<std::uint32_t>(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = static_cast<std::uint32_t>(c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            digit = static_cast<std::uint32_t>(c - 'A' + 10);
+        }
+        else
+        {
+            return false;
+        }
+        id = id << 4 | digit;
+    }
+    return true;
+}
+
+/* Calls visit for every pattern of the lists, patterns in a list are
+ * separated by ':' */
+template <class Visit>
+void for_each_pattern(const char* const* lists, std::size_t count, Visit visit)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::string_view list(lists[i]);
+        while (!list.empty())
+        {
+            const std::size_t end = list.find(':');
+            const std::string_view pattern = list.substr(0, end);
+            if (!pattern.empty())
+            {
+                visit(pattern);
+            }
+            list = end != std::string_view::npos ? list.substr(end + 1) : std::string_view();
+        }
+    }
+}
+
+bool passes(const TestCaseNode& test, const char* const* lists, std::size_t count)
+{
+    bool has_includes = false;
+    bool included = false;
+    bool excluded = false;
+    for_each_pattern(lists, count, [&](std::string_view pattern) {
+        if (pattern[0] == '-')
+        {
+            excluded = excluded || matches(test, pattern.substr(1));
+        }
+        else
+        {
+            has_includes = true;
+            included = included || matches(test, pattern);
+        }
+    });
+    return !excluded && (included || !has_includes);
+}
+
+/* Suite names are identifiers, so the part of a pattern before its first
+ * '.' matches the suite alone unless a * in it may span the '.' */
+Verdict pattern_verdict(const char* suite, std::string_view pattern)
+{
+    std::uint32_t id;
+    const std::size_t dot = pattern.find('.');
+    if (parse_id(pattern, id) || dot == std::string_view::npos || pattern.substr(0, dot).find('*') != std::string_view::npos)
+    {
+        return Verdict::some;
+    }
+    if (!glob(pattern.substr(0, dot), std::string_view(suite)))
+    {
+        return Verdict::none;
+    }
+    return pattern.substr(dot + 1) == "*" ? Verdict::all : Verdict::some;
+}
+
+Verdict suite_verdict(const char* suite, const char* const* lists, std::size_t count)
+{
+    bool has_includes = false;
+    Verdict included = Verdict::none;
+    Verdict excluded = Verdict::none;
+    for_each_pattern(lists, count, [&](std::string_view pattern) {
+        if (pattern[0] == '-')
+        {
+            const Verdict verdict = pattern_verdict(suite, pattern.substr(1));
+            excluded = verdict > excluded ? verdict : excluded;
+        }
+        else
+        {
+            has_includes = true;
+            const Verdict verdict = pattern_verdict(suite, pattern);
+            included = verdict > included ? verdict : included;
+        }
+    });
+    if (!has_includes)
+    {
+        included = Verdict::all;
+    }
+    if (excluded == Verdict::all || included == Verdict::none)
+    {
+        return Verdict::none;
+    }
+    return excluded == Verdict::some ? Verdict::some : included;
+}
+
+} // namespace
+
+bool matches(const TestCaseNode& test, std::string_view pattern)
+{
+    std::uint32_t id;
+    if (parse_id(pattern, id))
+    {
+        return test.id() == id;
+    }
+    return glob(pattern, TestName(test));
+}
+
+bool passes_filters(const TestCaseNode& test, const Options& options)
+{
+    return passes(test, &options.filter, options.filter != nullptr ? 1 : 0) && passes(test, options.filters, options.filter_count);
+}
+
+Verdict suite_verdict(const char* suite, const Options& options)
+{
+    const Verdict filter = suite_verdict(suite, &options.filter, options.filter != nullptr ? 1 : 0);
+    const Verdict filters = suite_verdict(suite, options.filters, options.filter_count);
+    return filter < filters ? filter : filters;
+}
+
+std::size_t count_passing(const Options& options)
+{
+    std::size_t count = 0;
+    for_each_passing(options, [&count](TestCaseNode&) { ++count; });
+    return count;
+}
+
+} // namespace detail
+} // namespace mstest
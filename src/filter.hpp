@@ -0,0 +1,105 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "mstest/detail/testcase_node.hpp"
+#include "mstest/detail/testlist.hpp"
+#include "mstest/options.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+/* True when pattern selects test. Patterns are globs over the full name
+ * "suite.testcase", where * matches any run of characters and ? a single
+ * one, or the id of the test written as 0x and up to 8 hex digits. */
+bool matches(const TestCaseNode& test, std::string_view pattern);
+
+/* True when test passes both Options::filter and Options::filters. Each
+ * of them selects the tests matching one of its include patterns, or all
+ * when it has none, minus those matching an exclude pattern. */
+bool passes_filters(const TestCaseNode& test, const Options& options);
+
+/* What the filters say about all tests of a suite */
+enum class Verdict : std::uint8_t
+{
+    none,
+    /* Depends on the test case, it has to be matched */
+    some,
+    all
+};
+
+Verdict suite_verdict(const char* suite, const Options& options);
+
+inline bool has_filters(const Options& options)
+{
+    return options.filter != nullptr || options.filter_count != 0;
+}
+
+/* Calls visit for every test passing the filters, in registration order.
+ * Tests of a suite mostly come from one translation unit and are
+ * registered in a row, so the filters are applied once per run of tests
+ * of the same suite: a suite they rule out costs a name comparison per
+ * test. Without filters every test is visited as it is. */
+template <class Visit>
+void for_each_passing(const Options& options, Visit visit)
+{
+    TestList& list = TestList::get();
+    if (!has_filters(options))
+    {
+        for (auto it = list.begin(); it != list.end(); ++it)
+        {
+            visit(*it);
+        }
+        return;
+    }
+
+    const char* suite = nullptr;
+    Verdict verdict = Verdict::none;
+    for (auto it = list.begin(); it != list.end(); ++it)
+    {
+        TestCaseNode& test = *it;
+        if (suite == nullptr || (suite != test.suite() && strcmp(suite, test.suite()) != 0))
+        {
+            suite = test.suite();
+            verdict = suite_verdict(suite, options);
+        }
+        if (verdict == Verdict::all || (verdict == Verdict::some && passes_filters(test, options)))
+        {
+            visit(test);
+        }
+    }
+}
+
+std::size_t count_passing(const Options& options);
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,443 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mstest/detail/context.hpp"
+
+#include "runner_internal.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* Sent by a worker after every test, followed by the TestRecord when the
+ * test recorded anything. Failure records only point to string literals and
+ * functions, which are at the same addresses in the forked parent. */
+struct ResultHeader
+{
+    std::uint64_t setup_ns;
+    std::uint64_t execute_ns;
+    std::uint64_t teardown_ns;
+    AllocationStats heap;
+    CounterStats counters;
+    std::uint32_t task;
+    std::uint32_t budget_ms;
+    std::uint8_t passed;
+    std::uint8_t timed_out;
+    std::uint8_t has_record;
+};
+
+using clock = std::chrono::steady_clock;
+
+struct Worker
+{
+    pid_t pid = -1;
+    int commands = -1;
+    int results = -1;
+    std::optional<std::size_t> task;
+    clock::time_point started;
+    /* Zero when the test may run forever */
+    std::uint32_t limit_ms = 0;
+    bool killed = false;
+};
+
+struct IsolatedResult
+{
+    bool done = false;
+    std::unique_ptr<TestRecord> record;
+    std::string crash;
+};
+
+bool write_all(int fd, const void* data, std::size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size != 0)
+    {
+        const ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, std::size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size != 0)
+    {
+        const ssize_t received = read(fd, bytes, size);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+[[noreturn]] void worker_main(int commands, int results, const std::vector<TestCaseNode*>& tests)
+{
+    Context& context = Context::get();
+    std::uint32_t task;
+    while (read_all(commands, &task, sizeof(task)))
+    {
+        /* Suites are set up on first use in every worker */
+        const TestResult& result = run_repeated(*tests[task], ends_suite(tests, task));
+        fflush(stdout);
+
+        const TestRecord& record = context.record();
+        ResultHeader header{result.setup_ns, result.execute_ns, result.teardown_ns, result.heap, result.counters, task, result.budget_ms,
+            result.passed, result.timed_out, !record.empty()};
+        if (!write_all(results, &header, sizeof(header)) || (header.has_record && !write_all(results, &record, sizeof(record))))
+        {
+            break;
+        }
+    }
+    leave_suite();
+    _exit(0);
+}
+
+void close_worker(Worker& worker)
+{
+    close(worker.commands);
+    close(worker.results);
+    worker.commands = -1;
+    worker.results = -1;
+}
+
+bool spawn_worker(Worker& worker, std::vector<Worker>& workers, const std::vector<TestCaseNode*>& tests)
+{
+    int commands[2];
+    int results[2];
+    if (pipe(commands) != 0)
+    {
+        return false;
+    }
+    if (pipe(results) != 0)
+    {
+        close(commands[0]);
+        close(commands[1]);
+        return false;
+    }
+
+    /* The child must not write buffered output a second time */
+    report_output().flush();
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(commands[0]);
+        close(commands[1]);
+        close(results[0]);
+        close(results[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        /* Pipes of other workers must not stay open here, otherwise they
+         * never see end of file when the parent shuts them down. */
+        for (auto& other : workers)
+        {
+            if (&other != &worker && other.pid > 0)
+            {
+                close_worker(other);
+            }
+        }
+        close(commands[1]);
+        close(results[0]);
+        worker_main(commands[0], results[1], tests);
+    }
+
+    close(commands[0]);
+    close(results[1]);
+    worker.pid = pid;
+    worker.commands = commands[1];
+    worker.results = results[0];
+    worker.task.reset();
+    worker.killed = false;
+    return true;
+}
+
+std::string describe_exit(pid_t pid)
+{
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+
+    char description[128];
+    if (WIFSIGNALED(status))
+    {
+        snprintf(description, sizeof(description), "killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    }
+    else if (WIFEXITED(status))
+    {
+        snprintf(description, sizeof(description), "exited with code %d", WEXITSTATUS(status));
+    }
+    else
+    {
+        snprintf(description, sizeof(description), "terminated");
+    }
+    return description;
+}
+
+} // namespace
+
+int run_isolated(const Options& options)
+{
+    Report report(options);
+    const std::vector<TestCaseNode*> tests = selected_tests(report);
+    std::vector<IsolatedResult> results(tests.size());
+
+    std::size_t jobs = options.jobs;
+    if (jobs == 0)
+    {
+        jobs = static_cast<std::size_t>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+    }
+    jobs = std::min(jobs, std::max<std::size_t>(tests.size(), 1));
+
+    /* A worker dying between tests must not kill the parent on write */
+    struct sigaction ignore_pipe{};
+    struct sigaction previous_pipe{};
+    ignore_pipe.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore_pipe, &previous_pipe);
+
+    report_start(report, tests.size());
+
+    std::vector<Worker> workers(jobs);
+    for (auto& worker : workers)
+    {
+        if (!spawn_worker(worker, workers, tests))
+        {
+            perror("mstest: unable to start worker process");
+            sigaction(SIGPIPE, &previous_pipe, nullptr);
+            return -1;
+        }
+    }
+
+    const TestRecord empty{};
+
+    /* Tests past the failure limit are neither started nor reported */
+    std::size_t end_task = tests.size();
+    std::size_t next_task = 0;
+    std::size_t next_report = 0;
+    std::vector<pollfd> descriptors;
+    std::vector<Worker*> polled;
+
+    while (next_report < end_task)
+    {
+        for (auto& worker : workers)
+        {
+            while (!worker.task && next_task < end_task)
+            {
+                const std::uint32_t task = static_cast<std::uint32_t>(next_task);
+                if (write_all(worker.commands, &task, sizeof(task)))
+                {
+                    worker.task = next_task++;
+                    worker.started = clock::now();
+                    worker.limit_ms = tests[task]->timeout_ms();
+                    if (worker.limit_ms == 0)
+                    {
+                        worker.limit_ms = options.hang_timeout_ms;
+                    }
+                    break;
+                }
+                /* Worker is gone before it got the test, replace it */
+                close_worker(worker);
+                describe_exit(worker.pid);
+                if (!spawn_worker(worker, workers, tests))
+                {
+                    perror("mstest: unable to restart worker process");
+                    sigaction(SIGPIPE, &previous_pipe, nullptr);
+                    return -1;
+                }
+            }
+        }
+
+        descriptors.clear();
+        polled.clear();
+        int timeout_ms = -1;
+        const clock::time_point now = clock::now();
+        for (auto& worker : workers)
+        {
+            if (!worker.task)
+            {
+                continue;
+            }
+            descriptors.push_back(pollfd{worker.results, POLLIN, 0});
+            polled.push_back(&worker);
+
+            if (worker.limit_ms != 0 && !worker.killed)
+            {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - worker.started).count();
+                if (elapsed >= worker.limit_ms)
+                {
+                    /* Result pipe reaches end of file once it is gone */
+                    kill(worker.pid, SIGKILL);
+                    worker.killed = true;
+                    continue;
+                }
+                const int remaining = static_cast<int>(worker.limit_ms - elapsed);
+                timeout_ms = timeout_ms < 0 ? remaining : std::min(timeout_ms, remaining);
+            }
+        }
+
+        if (poll(descriptors.data(), descriptors.size(), timeout_ms) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("mstest: poll failed");
+            break;
+        }
+
+        for (std::size_t i = 0; i < descriptors.size(); ++i)
+        {
+            if (descriptors[i].revents == 0)
+            {
+                continue;
+            }
+            Worker& worker = *polled[i];
+            const std::size_t task = *worker.task;
+
+            ResultHeader header;
+            if (read_all(worker.results, &header, sizeof(header)))
+            {
+                std::unique_ptr<TestRecord> record;
+                if (header.has_record)
+                {
+                    record = std::make_unique<TestRecord>();
+                }
+                if (!record || read_all(worker.results, record.get(), sizeof(TestRecord)))
+                {
+                    TestResult result;
+                    result.passed = header.passed != 0;
+                    result.timed_out = header.timed_out != 0;
+                    result.budget_ms = header.budget_ms;
+                    result.setup_ns = header.setup_ns;
+                    result.execute_ns = header.execute_ns;
+                    result.teardown_ns = header.teardown_ns;
+                    result.heap = header.heap;
+                    result.counters = header.counters;
+                    tests[task]->result(result);
+                    worker.task.reset();
+                    results[task].record = std::move(record);
+                    results[task].done = true;
+                    continue;
+                }
+            }
+
+            close_worker(worker);
+            const std::string reason = describe_exit(worker.pid);
+            TestResult result;
+            result.execute_ns = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - worker.started).count());
+            result.timed_out = worker.killed;
+            result.budget_ms = worker.limit_ms;
+            tests[task]->result(result);
+
+            /* A killed worker is reported as timed out by the result */
+            if (!worker.killed)
+            {
+                results[task].crash = "worker process " + reason;
+            }
+            results[task].done = true;
+            if (!spawn_worker(worker, workers, tests))
+            {
+                perror("mstest: unable to restart worker process");
+                sigaction(SIGPIPE, &previous_pipe, nullptr);
+                return -1;
+            }
+        }
+
+        while (next_report < end_task && results[next_report].done)
+        {
+            const IsolatedResult& done = results[next_report];
+            report_test(*tests[next_report], done.record ? *done.record : empty, report,
+                done.crash.empty() ? nullptr : "Test crashed", done.crash.c_str());
+            ++next_report;
+            if (failure_limit_reached(report))
+            {
+                report.summary.skipped += static_cast<int>(tests.size() - next_report);
+                end_task = next_report;
+            }
+        }
+    }
+
+    for (auto& worker : workers)
+    {
+        /* Still busy with a test nobody waits for anymore */
+        if (worker.task)
+        {
+            kill(worker.pid, SIGKILL);
+        }
+        close_worker(worker);
+    }
+    for (auto& worker : workers)
+    {
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+    sigaction(SIGPIPE, &previous_pipe, nullptr);
+
+    return report_summary(report);
+}
+
+} // namespace detail
+} // namespace mstest
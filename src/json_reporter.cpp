@@ -0,0 +1,198 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdio>
+
+#include "mstest/detail/perf_counters.hpp"
+#include "mstest/reporter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* Writes text as a quoted JSON string */
+void write_string(Output& output, const char* text)
+{
+    output.write("\"", 1);
+    const char* run = text;
+    for (; *text != '\0'; ++text)
+    {
+        const unsigned char c = static_cast<unsigned char>(*text);
+        if (c != '"' && c != '\\' && c >= 0x20)
+        {
+            continue;
+        }
+        output.write(run, static_cast<std::size_t>(text - run));
+        if (c == '"' || c == '\\')
+        {
+            output.print("\\%c", c);
+        }
+        else
+        {
+            output.print("\\u%04x", c);
+        }
+        run = text + 1;
+    }
+    output.write(run, static_cast<std::size_t>(text - run));
+    output.write("\"", 1);
+}
+
+class JsonReporter : public Reporter
+{
+public:
+    void run_start(Output& output, const Options&, std::size_t tests) override
+    {
+        note_[0] = '\0';
+        output.print("{\"event\":\"start\",\"tests\":%llu}\n", static_cast<unsigned long long>(tests));
+    }
+
+    void note(Output&, const TestCase&, const char* title, const char* text) override
+    {
+        snprintf(note_, sizeof(note_), "%s: %s", title, text);
+    }
+
+    void test_end(Output& output, const TestCase& test, const TestRecord& record) override
+    {
+        const TestResult& result = test.result();
+        output.print("{\"event\":\"test\",\"suite\":");
+        write_string(output, test.suite());
+        output.print(",\"test\":");
+        write_string(output, test.testcase());
+        output.print(",\"passed\":%s,\"timed_out\":%s,\"budget_ms\":%u,\"setup_ns\":%llu,\"execute_ns\":%llu,\"teardown_ns\":%llu",
+            result.passed ? "true" : "false", result.timed_out ? "true" : "false", static_cast<unsigned>(result.budget_ms),
+            static_cast<unsigned long long>(result.setup_ns), static_cast<unsigned long long>(result.execute_ns),
+            static_cast<unsigned long long>(result.teardown_ns));
+
+        output.print(",\"failures\":[");
+        bool first = true;
+        for (const FailureRecord& failure : record.failures)
+        {
+            char message[256];
+            format_failure(failure, message, sizeof(message));
+            output.print("%s{\"file\":", first ? "" : ",");
+            write_string(output, failure.file);
+            output.print(",\"line\":%d,\"message\":", static_cast<int>(failure.line));
+            write_string(output, message);
+            output.print("}");
+            first = false;
+        }
+        output.print("],\"dropped_failures\":%d", static_cast<int>(record.failures.dropped()));
+
+#if defined(MSTEST_ALLOCATION_TRACKING)
+        const AllocationStats& heap = result.heap;
+        output.print(",\"heap\":{\"allocations\":%u,\"frees\":%u,\"bytes\":%llu,\"peak_bytes\":%lld,\"leaked_blocks\":%u,\"leaked_bytes\":%lld}",
+            static_cast<unsigned>(heap.allocations), static_cast<unsigned>(heap.frees), static_cast<unsigned long long>(heap.bytes),
+            static_cast<long long>(heap.peak_bytes), static_cast<unsigned>(heap.leaked_blocks()),
+            static_cast<long long>(heap.leaked_blocks() != 0 ? heap.live_bytes : 0));
+#endif
+
+        write_counters(output, result.counters);
+
+        const BenchmarkStats& stats = record.benchmark;
+        if (stats.iterations != 0)
+        {
+            output.print(",\"benchmark\":{\"iterations\":%llu,\"samples\":%u,\"min_ns\":%.3f,\"median_ns\":%.3f,\"p99_ns\":%.3f,\"mean_ns\":%.3f}",
+                static_cast<unsigned long long>(stats.iterations), static_cast<unsigned>(stats.samples), stats.min_ns, stats.median_ns,
+                stats.p99_ns, stats.mean_ns);
+        }
+
+        const PropertyStats& property = record.property;
+        if (property.cases != 0)
+        {
+            output.print(",\"property\":{\"seed\":%llu,\"cases\":%u,\"shrinks\":%u,\"cases_per_second\":%.0f,\"falsified\":%s",
+                static_cast<unsigned long long>(property.seed), static_cast<unsigned>(property.cases), static_cast<unsigned>(property.shrinks),
+                property.cases_per_second(), property.falsified ? "true" : "false");
+            if (property.falsified)
+            {
+                output.print(",\"counterexample\":");
+                write_string(output, property.example);
+            }
+            output.print("}");
+        }
+
+        const RepeatStats& repeat = record.repeat;
+        if (repeat.runs != 0)
+        {
+            output.print(",\"repeat\":{\"runs\":%u,\"failures\":%u,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,\"unstable\":%s}",
+                static_cast<unsigned>(repeat.runs), static_cast<unsigned>(repeat.failures), static_cast<unsigned long long>(repeat.p50_ns),
+                static_cast<unsigned long long>(repeat.p99_ns), static_cast<unsigned long long>(repeat.max_ns),
+                repeat.unstable() ? "true" : "false");
+        }
+
+        if (note_[0] != '\0')
+        {
+            output.print(",\"note\":");
+            write_string(output, note_);
+            note_[0] = '\0';
+        }
+        output.print("}\n");
+    }
+
+    void run_end(Output& output, const Summary& summary) override
+    {
+        output.print("{\"event\":\"summary\",\"executed\":%d,\"passed\":%d,\"failed\":%d,\"skipped\":%d", summary.executed,
+            summary.passed, summary.executed - summary.passed, summary.skipped);
+        write_counters(output, summary.counters);
+        output.print("}\n");
+    }
+
+private:
+    /* Only the events that were counted */
+    static void write_counters(Output& output, const CounterStats& counters)
+    {
+        if (counters.available == 0)
+        {
+            return;
+        }
+        const char* separator = "";
+        output.print(",\"counters\":{");
+        for (unsigned i = 0; i < static_cast<unsigned>(CounterEvent::count); ++i)
+        {
+            const CounterEvent event = static_cast<CounterEvent>(i);
+            if (counters.has(event))
+            {
+                output.print("%s\"%s\":%llu", separator, counter_name(event), static_cast<unsigned long long>(counters[event]));
+                separator = ",";
+            }
+        }
+        output.print("}");
+    }
+
+    char note_[160] = {};
+};
+
+} // namespace
+} // namespace detail
+
+Reporter& json_reporter()
+{
+    static detail::JsonReporter reporter;
+    return reporter;
+}
+
+} // namespace mstest
@@ -0,0 +1,232 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdio>
+
+#include "mstest/detail/perf_counters.hpp"
+#include "mstest/reporter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+void write_escaped(Output& output, const char* text)
+{
+    const char* run = text;
+    for (; *text != '\0'; ++text)
+    {
+        const char* entity = nullptr;
+        switch (*text)
+        {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            case '\'': entity = "&apos;"; break;
+            default:
+                /* Not allowed in XML 1.0 at all */
+                if (static_cast<unsigned char>(*text) < 0x20 && *text != '\t' && *text != '\n' && *text != '\r')
+                {
+                    entity = "?";
+                }
+                break;
+        }
+        if (entity != nullptr)
+        {
+            output.write(run, static_cast<std::size_t>(text - run));
+            output.print("%s", entity);
+            run = text + 1;
+        }
+    }
+    output.write(run, static_cast<std::size_t>(text - run));
+}
+
+class JunitReporter : public Reporter
+{
+public:
+    void run_start(Output& output, const Options&, std::size_t) override
+    {
+        suite_open_ = false;
+        note_[0] = '\0';
+        output.print("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n");
+    }
+
+    void suite_start(Output& output, const char* suite) override
+    {
+        close_suite(output);
+        output.print("  <testsuite name=\"");
+        write_escaped(output, suite);
+        output.print("\">\n");
+        suite_open_ = true;
+    }
+
+    void note(Output&, const TestCase&, const char* title, const char* text) override
+    {
+        snprintf(note_, sizeof(note_), "%s: %s", title, text);
+    }
+
+    void test_end(Output& output, const TestCase& test, const TestRecord& record) override
+    {
+        const TestResult& result = test.result();
+        output.print("    <testcase classname=\"");
+        write_escaped(output, test.suite());
+        output.print("\" name=\"");
+        write_escaped(output, test.testcase());
+        output.print("\" time=\"%.6f\"", static_cast<double>(result.total_ns()) / 1e9);
+        if (result.passed && note_[0] == '\0' && record.benchmark.iterations == 0 && record.property.cases == 0 && record.repeat.runs == 0)
+        {
+            output.print("/>\n");
+            return;
+        }
+        output.print(">\n");
+
+        if (note_[0] != '\0')
+        {
+            output.print("      <error message=\"");
+            write_escaped(output, note_);
+            output.print("\"/>\n");
+            note_[0] = '\0';
+        }
+        else if (!result.passed)
+        {
+            write_failure(output, result, record);
+        }
+
+        const BenchmarkStats& stats = record.benchmark;
+        if (stats.iterations != 0)
+        {
+            output.print("      <system-out>min %.1f ns, median %.1f ns, p99 %.1f ns, mean %.1f ns per iteration</system-out>\n",
+                stats.min_ns, stats.median_ns, stats.p99_ns, stats.mean_ns);
+        }
+
+        const PropertyStats& property = record.property;
+        if (property.cases != 0)
+        {
+            output.print("      <system-out>%u cases, %.0f cases/s, seed %llu", static_cast<unsigned>(property.cases),
+                property.cases_per_second(), static_cast<unsigned long long>(property.seed));
+            if (property.falsified)
+            {
+                output.print(", shrunk %u times, counterexample: ", static_cast<unsigned>(property.shrinks));
+                write_escaped(output, property.example);
+            }
+            output.print("</system-out>\n");
+        }
+
+        const RepeatStats& repeat = record.repeat;
+        if (repeat.runs != 0)
+        {
+            output.print("      <system-out>%u runs, %u failed, p50 %llu ns, p99 %llu ns, max %llu ns</system-out>\n",
+                static_cast<unsigned>(repeat.runs), static_cast<unsigned>(repeat.failures), static_cast<unsigned long long>(repeat.p50_ns),
+                static_cast<unsigned long long>(repeat.p99_ns), static_cast<unsigned long long>(repeat.max_ns));
+        }
+
+        const CounterStats& counters = test.result().counters;
+        if (counters.available != 0)
+        {
+            char text[160];
+            format_counters(counters, text, sizeof(text));
+            output.print("      <system-out>%s</system-out>\n", text);
+        }
+        output.print("    </testcase>\n");
+    }
+
+    void run_end(Output& output, const Summary&) override
+    {
+        close_suite(output);
+        output.print("</testsuites>\n");
+    }
+
+private:
+    void close_suite(Output& output)
+    {
+        if (suite_open_)
+        {
+            output.print("  </testsuite>\n");
+            suite_open_ = false;
+        }
+    }
+
+    static void write_failure(Output& output, const TestResult& result, const TestRecord& record)
+    {
+        /* The first failure is the message, all of them go to the body */
+        char message[256];
+        char timeout[96];
+        char leak[96];
+        snprintf(timeout, sizeof(timeout), "Timeout: took %.3f ms, budget is %u ms", static_cast<double>(result.total_ns()) / 1e6,
+            static_cast<unsigned>(result.budget_ms));
+        snprintf(leak, sizeof(leak), "Leak: %u blocks, %lld bytes still allocated after teardown",
+            static_cast<unsigned>(result.heap.leaked_blocks()), static_cast<long long>(result.heap.live_bytes));
+        const bool leaked = result.heap.leaked_blocks() != 0;
+        if (record.failures.size() != 0)
+        {
+            format_failure(*record.failures.begin(), message, sizeof(message));
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "%s", result.timed_out ? timeout : leaked ? leak : "Test failed");
+        }
+
+        output.print("      <failure message=\"");
+        write_escaped(output, message[0] != '\0' ? message : "Test failed");
+        output.print("\">");
+        for (const FailureRecord& failure : record.failures)
+        {
+            format_failure(failure, message, sizeof(message));
+            output.print("%s:%d: ", failure.file, static_cast<int>(failure.line));
+            write_escaped(output, message);
+            output.print("\n");
+        }
+        if (record.failures.dropped() != 0)
+        {
+            output.print("... and %d more failures\n", static_cast<int>(record.failures.dropped()));
+        }
+        if (result.timed_out)
+        {
+            output.print("%s\n", timeout);
+        }
+        if (leaked)
+        {
+            output.print("%s\n", leak);
+        }
+        output.print("</failure>\n");
+    }
+
+    bool suite_open_ = false;
+    char note_[160] = {};
+};
+
+} // namespace
+} // namespace detail
+
+Reporter& junit_reporter()
+{
+    static detail::JunitReporter reporter;
+    return reporter;
+}
+
+} // namespace mstest
@@ -0,0 +1,117 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Log-linear histogram in the manner of HdrHistogram: every power of two
+ * is split into 8 buckets, so a value is known to 1/8 of itself in fixed
+ * memory whatever the range. Values of 2^40 ns and more share the last
+ * bucket, the maximum is kept exactly. */
+class LatencyHistogram
+{
+public:
+    void clear()
+    {
+        for (std::uint32_t& count : counts_)
+        {
+            count = 0;
+        }
+        total_ = 0;
+        max_ = 0;
+    }
+
+    void record(std::uint64_t value)
+    {
+        ++counts_[index(value < limit ? value : limit - 1)];
+        ++total_;
+        max_ = value > max_ ? value : max_;
+    }
+
+    /* Highest value of the bucket holding the value at percent, no more
+     * than the maximum */
+    std::uint64_t percentile(double percent) const
+    {
+        std::uint64_t rank = static_cast<std::uint64_t>(static_cast<double>(total_) * percent / 100 + 0.5);
+        rank = rank == 0 ? 1 : rank;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                const std::uint64_t highest = lowest(i + 1) - 1;
+                return highest < max_ ? highest : max_;
+            }
+        }
+        return max_;
+    }
+
+    std::uint64_t max() const
+    {
+        return max_;
+    }
+
+private:
+    static constexpr unsigned sub_bits = 3;
+    static constexpr std::uint64_t sub_count = 1u << sub_bits;
+    static constexpr std::uint64_t limit = std::uint64_t(1) << 40;
+    /* Values below 2 * sub_count get a bucket each */
+    static constexpr std::size_t bucket_count = (40 - sub_bits + 1) * sub_count;
+
+    static std::size_t index(std::uint64_t value)
+    {
+        if (value < 2 * sub_count)
+        {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned shift = 63u - static_cast<unsigned>(__builtin_clzll(value)) - sub_bits;
+        return static_cast<std::size_t>((shift + 1) * sub_count + (value >> shift) - sub_count);
+    }
+
+    /* Lowest value of bucket i */
+    static std::uint64_t lowest(std::size_t i)
+    {
+        if (i < 2 * sub_count)
+        {
+            return i;
+        }
+        const std::uint64_t shift = i / sub_count - 1;
+        return (sub_count + i % sub_count) << shift;
+    }
+
+    std::uint32_t counts_[bucket_count] = {};
+    std::uint64_t total_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,309 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string_view>
+
+#include "mstest/options.hpp"
+
+namespace mstest
+{
+namespace
+{
+
+void print_usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --jobs=N           run tests on N workers, 0 = one per hardware thread\n");
+    fprintf(stderr, "  --isolate          run every test in a forked worker process\n");
+    fprintf(stderr, "  --filter=PATTERNS  run only tests matching PATTERNS, globs over\n");
+    fprintf(stderr, "                     suite.testcase separated by ':', a leading '-'\n");
+    fprintf(stderr, "                     excludes, e.g. --filter=net.*:-net.slow_*\n");
+    fprintf(stderr, "  --list             list the selected tests and exit\n");
+    fprintf(stderr, "  --shard-count=N    split tests into N disjoint shards\n");
+    fprintf(stderr, "  --shard-index=I    run only shard I (0 based)\n");
+    fprintf(stderr, "  --manifest         list tests balanced over --shard-count shards by their\n");
+    fprintf(stderr, "                     durations and exit\n");
+    fprintf(stderr, "  --durations=FILE   result cache the manifest takes durations from\n");
+    fprintf(stderr, "  --shard-plan=FILE  run the tests a manifest assigns to --shard-index\n");
+    fprintf(stderr, "  --slowest=N        list N slowest tests after the summary, 0 disables\n");
+    fprintf(stderr, "  --hang-timeout=MS  abort a test running longer than MS milliseconds\n");
+    fprintf(stderr, "  --format=FORMAT    console (default), junit, json (JSON Lines) or binary,\n");
+    fprintf(stderr, "                     decoded with mstest_decode\n");
+    fprintf(stderr, "  --no-color         console output without ANSI colors\n");
+    fprintf(stderr, "  --quiet            console output lists only failed tests\n");
+    fprintf(stderr, "  --seed=N           seed of the inputs property tests generate\n");
+    fprintf(stderr, "  --property-cases=N cases generated per property test\n");
+    fprintf(stderr, "  --max-failures=N   stop starting tests after N failures\n");
+    fprintf(stderr, "  --repeat=N         run every test N times, list flaky and erratic ones\n");
+    fprintf(stderr, "  --repeat-for=MS    repeat every test for MS milliseconds\n");
+    fprintf(stderr, "  --cache=FILE       read and write results of the previous run\n");
+    fprintf(stderr, "  --failed-first     run tests that failed in the cached run first\n");
+    fprintf(stderr, "  --skip-unchanged   skip tests that passed in the cached run and whose\n");
+    fprintf(stderr, "                     source file did not change since\n");
+    fprintf(stderr, "  --baseline=FILE    fail tests slower than their timings in FILE\n");
+    fprintf(stderr, "  --baseline-tolerance=PCT\n");
+    fprintf(stderr, "                     slowdown allowed over the baseline, 10 by default\n");
+    fprintf(stderr, "  --update-baseline  add timings of passing tests to the baseline\n");
+    fprintf(stderr, "  --serve            take commands from stdin and report to stdout\n");
+}
+
+template <class Number>
+bool parse_number(std::string_view value, Number& number)
+{
+    if (value.empty())
+    {
+        return false;
+    }
+    number = 0;
+    for (const char c : value)
+    {
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        const Number digit = static_cast<Number>(c - '0');
+        if (number > (std::numeric_limits<Number>::max() - digit) / 10)
+        {
+            return false;
+        }
+        number = static_cast<Number>(number * 10 + digit);
+    }
+    return true;
+}
+
+bool parse_flag(std::string_view arg, std::string_view flag, std::string_view& value)
+{
+    if (arg.substr(0, flag.size()) != flag)
+    {
+        return false;
+    }
+    value = arg.substr(flag.size());
+    return true;
+}
+
+#if !defined(MSTEST_HOST)
+/* Need processes, threads or files a target does not have */
+constexpr std::string_view host_only_options[] = {"--isolate", "--manifest", "--shard-plan=", "--durations=",
+    "--hang-timeout=", "--cache=", "--failed-first", "--skip-unchanged", "--baseline", "--update-baseline"};
+
+bool host_only(std::string_view arg)
+{
+    for (const std::string_view option : host_only_options)
+    {
+        if (arg.substr(0, option.size()) == option)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+} // namespace
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        std::string_view value;
+        bool valid = true;
+
+#if !defined(MSTEST_HOST)
+        if (host_only(arg))
+        {
+            fprintf(stderr, "%s is supported only on host builds\n", argv[i]);
+            return false;
+        }
+#endif
+        if (arg == "--isolate")
+        {
+            options.isolate = true;
+        }
+        else if (arg == "--no-color")
+        {
+            options.color = false;
+        }
+        else if (arg == "--quiet")
+        {
+            options.quiet = true;
+        }
+        else if (arg == "--failed-first")
+        {
+            options.failed_first = true;
+        }
+        else if (arg == "--skip-unchanged")
+        {
+            options.skip_unchanged = true;
+        }
+        else if (arg == "--manifest")
+        {
+            options.manifest = true;
+        }
+        else if (arg == "--update-baseline")
+        {
+            options.update_baseline = true;
+        }
+        else if (arg == "--list")
+        {
+            options.list = true;
+        }
+        else if (arg == "--serve")
+        {
+            options.serve = true;
+        }
+        else if (parse_flag(arg, "--filter=", value))
+        {
+            options.filter = argv[i] + (arg.size() - value.size());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--cache=", value))
+        {
+            options.cache_file = argv[i] + (arg.size() - value.size());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--shard-plan=", value))
+        {
+            options.shard_plan_file = argv[i] + (arg.size() - value.size());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--durations=", value))
+        {
+            options.durations_file = argv[i] + (arg.size() - value.size());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--baseline=", value))
+        {
+            options.baseline_file = argv[i] + (arg.size() - value.size());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--baseline-tolerance=", value))
+        {
+            valid = parse_number(value, options.baseline_tolerance_percent);
+        }
+        else if (parse_flag(arg, "--seed=", value))
+        {
+            valid = parse_number(value, options.seed);
+        }
+        else if (parse_flag(arg, "--property-cases=", value))
+        {
+            valid = parse_number(value, options.property_cases);
+        }
+        else if (parse_flag(arg, "--max-failures=", value))
+        {
+            valid = parse_number(value, options.max_failures);
+        }
+        else if (parse_flag(arg, "--repeat=", value))
+        {
+            valid = parse_number(value, options.repeat) && options.repeat != 0;
+        }
+        else if (parse_flag(arg, "--repeat-for=", value))
+        {
+            valid = parse_number(value, options.repeat_for_ms);
+        }
+        else if (parse_flag(arg, "--jobs=", value))
+        {
+            valid = parse_number(value, options.jobs);
+        }
+        else if (parse_flag(arg, "--shard-count=", value))
+        {
+            valid = parse_number(value, options.shard_count) && options.shard_count != 0;
+        }
+        else if (parse_flag(arg, "--shard-index=", value))
+        {
+            valid = parse_number(value, options.shard_index);
+        }
+        else if (parse_flag(arg, "--slowest=", value))
+        {
+            valid = parse_number(value, options.slowest);
+        }
+        else if (parse_flag(arg, "--hang-timeout=", value))
+        {
+            valid = parse_number(value, options.hang_timeout_ms);
+        }
+        else if (parse_flag(arg, "--format=", value))
+        {
+            if (value == "console")
+            {
+                options.format = Format::console;
+            }
+            else if (value == "binary")
+            {
+                options.format = Format::binary;
+            }
+            else if (value == "junit")
+            {
+                options.format = Format::junit;
+            }
+            else if (value == "json")
+            {
+                options.format = Format::json;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            fprintf(stderr, "Unknown or malformed option: %s\n", argv[i]);
+            print_usage(argc > 0 ? argv[0] : "mstest");
+            return false;
+        }
+    }
+
+    if (options.shard_index >= options.shard_count)
+    {
+        fprintf(stderr, "--shard-index must be lower than --shard-count\n");
+        return false;
+    }
+    if ((options.failed_first || options.skip_unchanged) && options.cache_file == nullptr)
+    {
+        fprintf(stderr, "--failed-first and --skip-unchanged need --cache\n");
+        return false;
+    }
+    if (options.update_baseline && options.baseline_file == nullptr)
+    {
+        fprintf(stderr, "--update-baseline needs --baseline\n");
+        return false;
+    }
+#if !defined(MSTEST_HOST)
+    if (options.jobs != 1)
+    {
+        fprintf(stderr, "--jobs is supported only on host builds\n");
+        return false;
+    }
+#endif
+    return true;
+}
+
+} // namespace mstest
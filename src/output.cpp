@@ -0,0 +1,118 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "mstest/output.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace mstest
+{
+
+Output::Output(WriteFunction write)
+    : write_(write)
+{
+}
+
+Output::~Output()
+{
+    flush();
+}
+
+void Output::destination(WriteFunction write)
+{
+    flush();
+    write_ = write;
+}
+
+void Output::stream(std::FILE* stream)
+{
+    flush();
+    stream_ = stream;
+}
+
+void Output::print(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+
+    int size = vsnprintf(buffer_ + size_, sizeof(buffer_) - size_, format, args);
+    if (size >= 0 && static_cast<std::size_t>(size) >= sizeof(buffer_) - size_)
+    {
+        flush();
+        size = vsnprintf(buffer_, sizeof(buffer_), format, retry);
+        if (size >= 0 && static_cast<std::size_t>(size) >= sizeof(buffer_))
+        {
+            size = sizeof(buffer_) - 1;
+        }
+    }
+    if (size > 0)
+    {
+        size_ += static_cast<std::size_t>(size);
+    }
+
+    va_end(retry);
+    va_end(args);
+}
+
+void Output::write(const void* data, std::size_t size)
+{
+    if (size > sizeof(buffer_) - size_)
+    {
+        flush();
+        if (size >= sizeof(buffer_))
+        {
+            write_out(data, size);
+            return;
+        }
+    }
+    memcpy(buffer_ + size_, data, size);
+    size_ += size;
+}
+
+void Output::flush()
+{
+    if (size_ != 0)
+    {
+        write_out(buffer_, size_);
+        size_ = 0;
+    }
+}
+
+void Output::write_out(const void* data, std::size_t size)
+{
+    if (write_ != nullptr)
+    {
+        write_(data, size);
+        return;
+    }
+    FILE* const stream = stream_ != nullptr ? stream_ : stdout;
+    fwrite(data, 1, size, stream);
+    fflush(stream);
+}
+
+} // namespace mstest
@@ -0,0 +1,174 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mstest/detail/context.hpp"
+
+#include "runner_internal.hpp"
+#include "watchdog.hpp"
+#include "work_stealing_queues.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+struct ParallelResult
+{
+    bool done = false;
+    /* Only tests that recorded something keep a copy */
+    std::unique_ptr<TestRecord> record;
+};
+
+} // namespace
+
+int run_parallel(const Options& options)
+{
+    std::size_t threads = options.jobs;
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    Report report(options);
+    const std::vector<TestCaseNode*> tests = selected_tests(report);
+
+    std::vector<ParallelResult> results(tests.size());
+    std::mutex results_mutex;
+    std::condition_variable result_ready;
+
+    /* Suites with hooks and async groups run as one task, on one thread */
+    std::vector<std::size_t> groups;
+    for (std::size_t begin = 0; begin < tests.size(); begin = group_end(tests, begin))
+    {
+        groups.push_back(begin);
+    }
+    groups.push_back(tests.size());
+
+    WorkStealingQueues queues(threads);
+    queues.distribute(groups.size() - 1);
+
+    Watchdog watchdog(options.hang_timeout_ms);
+    /* Set once the failure limit is reached in report order */
+    std::atomic<bool> stop{false};
+
+    auto worker = [&](std::size_t id) {
+        Watchdog::Watch watch(watchdog);
+        Context& context = Context::get();
+        std::vector<TestRecord> records;
+        while (auto task = queues.pop(id))
+        {
+            if (stop.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+            const std::size_t end = groups[*task + 1];
+            for (std::size_t begin = groups[*task]; begin < end;)
+            {
+                const std::size_t async_end = std::min(async_group_end(tests, begin), end);
+                if (async_end - begin == 1)
+                {
+                    run_repeated(*tests[begin], begin + 1 == end);
+                    std::unique_ptr<TestRecord> record;
+                    if (!context.record().empty())
+                    {
+                        record = std::make_unique<TestRecord>(context.record());
+                    }
+
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    results[begin].record = std::move(record);
+                    results[begin].done = true;
+                }
+                else
+                {
+                    records.assign(async_end - begin, TestRecord{});
+                    run_async_group(&tests[begin], async_end - begin, records.data(), async_end == end);
+                    std::vector<std::unique_ptr<TestRecord>> kept(async_end - begin);
+                    for (std::size_t i = 0; i < kept.size(); ++i)
+                    {
+                        if (!records[i].empty())
+                        {
+                            kept[i] = std::make_unique<TestRecord>(records[i]);
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    for (std::size_t i = begin; i < async_end; ++i)
+                    {
+                        results[i].record = std::move(kept[i - begin]);
+                        results[i].done = true;
+                    }
+                }
+                result_ready.notify_one();
+                begin = async_end;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t id = 0; id < threads; ++id)
+    {
+        workers.emplace_back(worker, id);
+    }
+
+    report_start(report, tests.size());
+    const TestRecord empty{};
+
+    /* Results are printed strictly in registration order, the same as
+     * run_tests() would print them. Tests finished past the failure limit
+     * are dropped, so the output still matches. */
+    for (std::size_t i = 0; i < tests.size(); ++i)
+    {
+        if (failure_limit_reached(report))
+        {
+            stop = true;
+            report.summary.skipped += static_cast<int>(tests.size() - i);
+            break;
+        }
+        {
+            std::unique_lock<std::mutex> lock(results_mutex);
+            result_ready.wait(lock, [&] { return results[i].done; });
+        }
+        report_test(*tests[i], results[i].record ? *results[i].record : empty, report);
+    }
+
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    return report_summary(report);
+}
+
+} // namespace detail
+} // namespace mstest
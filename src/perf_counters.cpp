@@ -0,0 +1,182 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Hardware counters of MSTEST_PERF_COUNTERS. Every thread opens its own
+ * group of user space counters, so the events of parallel tests stay
+ * apart. Counters the kernel refuses, e.g. in containers, under a
+ * perf_event_paranoid above 2 or on CPUs without a PMU, are left out. */
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "mstest/detail/context.hpp"
+#include "mstest/detail/perf_counters.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+constexpr std::size_t event_count = static_cast<std::size_t>(CounterEvent::count);
+
+/* Configuration of each CounterEvent */
+constexpr std::uint64_t event_configs[event_count] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+std::atomic<int> open_error{0};
+
+class CounterGroup
+{
+public:
+    CounterGroup() = default;
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    ~CounterGroup()
+    {
+        close_all();
+    }
+
+    void start()
+    {
+        /* A forked worker inherits counters of the parent's thread */
+        if (owner_ != getpid())
+        {
+            open();
+        }
+        if (members_ != 0)
+        {
+            ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    CounterStats stop()
+    {
+        CounterStats stats;
+        if (members_ == 0 || owner_ != getpid())
+        {
+            return stats;
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        /* Member count, time enabled, time running, one value per member */
+        std::uint64_t values[3 + event_count];
+        const ssize_t size = read(fds_[0], values, sizeof(values));
+        if (size < static_cast<ssize_t>((3 + members_) * sizeof(std::uint64_t)) || values[0] != members_ || values[2] == 0)
+        {
+            return stats;
+        }
+        /* The group shared the PMU with other groups for part of the time */
+        const double scale = static_cast<double>(values[1]) / static_cast<double>(values[2]);
+        for (std::size_t i = 0; i < members_; ++i)
+        {
+            const unsigned event = static_cast<unsigned>(events_[i]);
+            stats.available |= static_cast<std::uint8_t>(1u << event);
+            stats.counts[event] = values[2] < values[1] ? static_cast<std::uint64_t>(static_cast<double>(values[3 + i]) * scale)
+                                                        : values[3 + i];
+        }
+        return stats;
+    }
+
+private:
+    void open()
+    {
+        close_all();
+        owner_ = getpid();
+        for (std::size_t i = 0; i < event_count; ++i)
+        {
+            perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = event_configs[i];
+            /* The leader starts the whole group */
+            attributes.disabled = members_ == 0 ? 1 : 0;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const long fd = syscall(SYS_perf_event_open, &attributes, 0, -1, members_ != 0 ? fds_[0] : -1, PERF_FLAG_FD_CLOEXEC);
+            if (fd < 0)
+            {
+                open_error.store(errno, std::memory_order_relaxed);
+                continue;
+            }
+            fds_[members_] = static_cast<int>(fd);
+            events_[members_] = static_cast<CounterEvent>(i);
+            ++members_;
+        }
+    }
+
+    void close_all()
+    {
+        /* In a forked worker these are its copies of the parent's */
+        for (std::size_t i = 0; i < members_; ++i)
+        {
+            close(fds_[i]);
+        }
+        members_ = 0;
+    }
+
+    pid_t owner_ = 0;
+    std::size_t members_ = 0;
+    int fds_[event_count] = {};
+    CounterEvent events_[event_count] = {};
+};
+
+MSTEST_THREAD_LOCAL CounterGroup group;
+
+} // namespace
+
+void start_counters()
+{
+    group.start();
+}
+
+CounterStats stop_counters()
+{
+    return group.stop();
+}
+
+const char* counters_error()
+{
+    const int error = open_error.load(std::memory_order_relaxed);
+    return error != 0 ? strerror(error) : nullptr;
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,387 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include "mstest/detail/clock.hpp"
+#include "mstest/detail/context.hpp"
+#include "mstest/property.hpp"
+
+#include "runner_internal.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* Smaller means shorter, then lexicographically smaller */
+bool simpler(const ChoiceSequence& a, const ChoiceSequence& b)
+{
+    if (a.size != b.size)
+    {
+        return a.size < b.size;
+    }
+    for (std::size_t i = 0; i < a.size; ++i)
+    {
+        if (a.values[i] != b.values[i])
+        {
+            return a.values[i] < b.values[i];
+        }
+    }
+    return false;
+}
+
+void copy(ChoiceSequence& to, const ChoiceSequence& from)
+{
+    std::memcpy(to.values, from.values, from.size * sizeof(from.values[0]));
+    to.size = from.size;
+}
+
+/* Every case of every property gets its own stream */
+std::uint64_t case_seed(std::uint64_t seed, std::uint32_t id, std::uint32_t index)
+{
+    Random mix(seed ^ (static_cast<std::uint64_t>(id) << 32 | index));
+    return mix.next();
+}
+
+} // namespace
+
+/* Runs cases of one property and shrinks the first failing one */
+class PropertyRunner
+{
+public:
+    PropertyRunner(PropertyBody body, void* property, Source& source)
+        : body_(body)
+        , property_(property)
+        , source_(source)
+        , failures_(Context::get().failures())
+        , mark_(failures_.size())
+        , dropped_(failures_.dropped())
+    {
+    }
+
+    /* Runs the case source is set up for, true when it failed. A failed
+     * assert_* only ends the case. */
+    bool fails()
+    {
+        failures_.rewind(mark_, dropped_);
+        Context& context = Context::get();
+        std::jmp_buf escape;
+        std::jmp_buf* const volatile outer = context.escape(&escape);
+        if (setjmp(escape) == 0)
+        {
+            body_(property_);
+        }
+        context.escape(outer);
+        return failures_.size() > mark_ || failures_.dropped() > dropped_;
+    }
+
+    /* Remembers where the first failure happened, shrinking must not slip
+     * to a different bug */
+    void found(const ChoiceSequence& choices)
+    {
+        if (failures_.size() > mark_)
+        {
+            const FailureRecord& failure = failures_.begin()[mark_];
+            file_ = failure.file;
+            line_ = failure.line;
+        }
+        copy(best_, choices);
+    }
+
+    /* Replays best_ edited into attempt_, keeps it when it still fails the
+     * same way and is simpler */
+    bool attempt()
+    {
+        if (replays_ == MSTEST_PROPERTY_SHRINK_REPLAYS)
+        {
+            return false;
+        }
+        ++replays_;
+        source_.replay(attempt_, consumed_);
+        if (!fails() || !same_failure() || !simpler(consumed_, best_))
+        {
+            return false;
+        }
+        copy(best_, consumed_);
+        ++shrinks_;
+        return true;
+    }
+
+    std::uint32_t shrink()
+    {
+        bool improved = true;
+        while (improved && replays_ != MSTEST_PROPERTY_SHRINK_REPLAYS)
+        {
+            improved = false;
+            for (const std::size_t block : {8, 4, 2, 1})
+            {
+                improved = delete_blocks(block) || improved;
+            }
+            for (const std::size_t block : {8, 4, 2})
+            {
+                improved = zero_blocks(block) || improved;
+            }
+            improved = minimize_choices() || improved;
+        }
+        return shrinks_;
+    }
+
+    /* Runs the shrunk case once more, leaving its failures recorded and
+     * describing what it drew */
+    bool describe(char* example)
+    {
+        source_.replay(best_, consumed_, example);
+        return fails();
+    }
+
+private:
+    bool same_failure() const
+    {
+        if (file_ == nullptr)
+        {
+            return true;
+        }
+        if (failures_.size() <= mark_)
+        {
+            return false;
+        }
+        const FailureRecord& failure = failures_.begin()[mark_];
+        return failure.line == line_ && std::strcmp(failure.file, file_) == 0;
+    }
+
+    /* Removing choices removes elements of collections and whatever was
+     * drawn from them */
+    bool delete_blocks(std::size_t block)
+    {
+        bool improved = false;
+        std::size_t start = best_.size >= block ? best_.size - block + 1 : 0;
+        while (start-- > 0)
+        {
+            if (start + block > best_.size)
+            {
+                continue;
+            }
+            std::memcpy(attempt_.values, best_.values, start * sizeof(best_.values[0]));
+            std::memcpy(attempt_.values + start, best_.values + start + block, (best_.size - start - block) * sizeof(best_.values[0]));
+            attempt_.size = best_.size - block;
+            improved = attempt() || improved;
+        }
+        return improved;
+    }
+
+    bool zero_blocks(std::size_t block)
+    {
+        bool improved = false;
+        for (std::size_t start = 0; start + block <= best_.size; ++start)
+        {
+            copy(attempt_, best_);
+            bool changed = false;
+            for (std::size_t i = start; i < start + block; ++i)
+            {
+                changed = changed || attempt_.values[i] != 0;
+                attempt_.values[i] = 0;
+            }
+            improved = (changed && attempt()) || improved;
+        }
+        return improved;
+    }
+
+    /* Binary search for the smallest value of every choice that still fails */
+    bool minimize_choices()
+    {
+        bool improved = false;
+        for (std::size_t i = 0; i < best_.size; ++i)
+        {
+            std::uint64_t low = 0;
+            std::uint64_t high = best_.values[i];
+            while (low < high && i < best_.size)
+            {
+                const std::uint64_t middle = low + (high - low) / 2;
+                copy(attempt_, best_);
+                attempt_.values[i] = middle;
+                if (attempt())
+                {
+                    improved = true;
+                    high = i < best_.size ? best_.values[i] : 0;
+                }
+                else
+                {
+                    low = middle + 1;
+                }
+            }
+        }
+        return improved;
+    }
+
+    PropertyBody body_;
+    void* property_;
+    Source& source_;
+    FailureArena& failures_;
+    std::size_t mark_;
+    std::size_t dropped_;
+    const char* file_ = nullptr;
+    std::uint_least32_t line_ = 0;
+    std::uint32_t replays_ = 0;
+    std::uint32_t shrinks_ = 0;
+
+    /* Too large for the stack of small targets */
+    static MSTEST_THREAD_LOCAL ChoiceSequence best_;
+    static MSTEST_THREAD_LOCAL ChoiceSequence attempt_;
+    static MSTEST_THREAD_LOCAL ChoiceSequence consumed_;
+};
+
+MSTEST_THREAD_LOCAL ChoiceSequence PropertyRunner::best_;
+MSTEST_THREAD_LOCAL ChoiceSequence PropertyRunner::attempt_;
+MSTEST_THREAD_LOCAL ChoiceSequence PropertyRunner::consumed_;
+
+void run_property(std::uint32_t id, PropertyBody body, void* property)
+{
+    const Options& options = run_options();
+    const std::uint32_t cases = options.property_cases != 0 ? options.property_cases : MSTEST_PROPERTY_CASES;
+
+    Source source;
+    Source*& current = Source::current_pointer();
+    Source* const outer = current;
+    current = &source;
+
+    PropertyRunner run(body, property, source);
+    PropertyStats stats;
+    stats.seed = options.seed;
+
+    static MSTEST_THREAD_LOCAL ChoiceSequence choices;
+    const std::uint64_t start = Clock::now();
+    while (stats.cases < cases && !stats.falsified)
+    {
+        source.generate(case_seed(options.seed, id, stats.cases++), choices);
+        stats.falsified = run.fails();
+    }
+    stats.duration_ns = Clock::to_ns(Clock::now() - start);
+
+    if (stats.falsified)
+    {
+        run.found(choices);
+        stats.shrinks = run.shrink();
+        if (!run.describe(stats.example))
+        {
+            snprintf(stats.example, sizeof(stats.example), "none, the shrunk case passed when run again");
+        }
+    }
+
+    current = outer;
+    Context::get().property(stats);
+}
+
+} // namespace detail
+
+Source*& Source::current_pointer()
+{
+    static MSTEST_THREAD_LOCAL Source* current = nullptr;
+    return current;
+}
+
+std::uint64_t Source::choice(std::uint64_t bound)
+{
+    std::uint64_t value = 0;
+    if (replay_ == nullptr)
+    {
+        /* Bounds find more bugs than their share of a uniform draw */
+        const std::uint64_t random = random_.next();
+        if ((random & 15) == 1)
+        {
+            value = bound;
+        }
+        else if ((random & 15) != 0)
+        {
+            value = bound == std::numeric_limits<std::uint64_t>::max() ? random_.next() : random_.next() % (bound + 1);
+        }
+    }
+    push(value, bound);
+    return value;
+}
+
+bool Source::more()
+{
+    /* Seven elements on average */
+    std::uint64_t value = replay_ == nullptr && random_.next() % 8 != 0 ? 1 : 0;
+    push(value, 1);
+    return value != 0;
+}
+
+void Source::generate(std::uint64_t seed, detail::ChoiceSequence& record)
+{
+    random_ = detail::Random(seed);
+    replay_ = nullptr;
+    record_ = &record;
+    record.size = 0;
+    example_ = nullptr;
+}
+
+void Source::replay(const detail::ChoiceSequence& choices, detail::ChoiceSequence& record, char* example)
+{
+    replay_ = &choices;
+    record_ = &record;
+    record.size = 0;
+    example_ = example;
+    example_used_ = 0;
+    if (example != nullptr)
+    {
+        example[0] = '\0';
+    }
+}
+
+/* Records value, or while replaying replaces it with the recorded choice.
+ * Edited sequences may run short or hold values out of bound. */
+void Source::push(std::uint64_t& value, std::uint64_t bound)
+{
+    const std::size_t position = record_->size;
+    if (position == MSTEST_PROPERTY_MAX_CHOICES)
+    {
+        value = 0;
+        return;
+    }
+    if (replay_ != nullptr)
+    {
+        value = position < replay_->size ? replay_->values[position] : 0;
+        value = value < bound ? value : bound;
+    }
+    record_->values[record_->size++] = value;
+}
+
+void Source::describe(const char* text)
+{
+    if (example_used_ + 1 >= MSTEST_PROPERTY_EXAMPLE_SIZE)
+    {
+        return;
+    }
+    const int written = snprintf(example_ + example_used_, MSTEST_PROPERTY_EXAMPLE_SIZE - example_used_, "%s%s",
+        example_used_ != 0 ? ", " : "", text);
+    example_used_ += written > 0 ? static_cast<std::size_t>(written) : 0;
+}
+
+} // namespace mstest
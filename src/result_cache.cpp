@@ -0,0 +1,122 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+#include "result_cache.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* First line of the file, the number is bumped when the format changes */
+constexpr const char* cache_header = "mstest cache 1\n";
+
+bool by_id(const ResultCache::Entry& entry, std::uint32_t id)
+{
+    return entry.id < id;
+}
+
+} // namespace
+
+void ResultCache::load(const char* path)
+{
+    entries_.clear();
+    FILE* file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    char header[32];
+    if (fgets(header, sizeof(header), file) != nullptr && std::string(header) == cache_header)
+    {
+        /* id, fingerprint, passed, duration */
+        Entry entry;
+        unsigned passed;
+        while (fscanf(file, "%" SCNx32 " %" SCNx32 " %u %" SCNu64, &entry.id, &entry.fingerprint, &passed, &entry.duration_ns) == 4)
+        {
+            entry.passed = passed != 0;
+            entries_.push_back(entry);
+        }
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    }
+    fclose(file);
+}
+
+bool ResultCache::save(const char* path) const
+{
+    /* Readers never see a half written cache */
+    const std::string temporary = std::string(path) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = fputs(cache_header, file) >= 0;
+    for (const Entry& entry : entries_)
+    {
+        written = written && fprintf(file, "%08" PRIx32 " %08" PRIx32 " %u %" PRIu64 "\n", entry.id, entry.fingerprint,
+            entry.passed ? 1u : 0u, entry.duration_ns) > 0;
+    }
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+const ResultCache::Entry* ResultCache::find(const TestCaseNode& test) const
+{
+    const std::uint32_t id = test.id();
+    const auto entry = std::lower_bound(entries_.begin(), entries_.end(), id, by_id);
+    return entry != entries_.end() && entry->id == id ? &*entry : nullptr;
+}
+
+void ResultCache::update(const TestCaseNode& test)
+{
+    const TestResult& result = test.result();
+    const Entry updated{test.id(), test.fingerprint(), result.passed, result.total_ns()};
+    const auto entry = std::lower_bound(entries_.begin(), entries_.end(), updated.id, by_id);
+    if (entry != entries_.end() && entry->id == updated.id)
+    {
+        *entry = updated;
+    }
+    else
+    {
+        entries_.insert(entry, updated);
+    }
+}
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,79 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mstest/detail/testcase_node.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Outcome of every test in previous runs, kept in a small text file so the
+ * next run can reorder and skip tests. Tests that did not run this time,
+ * e.g. in another shard, keep their entry. */
+class ResultCache
+{
+public:
+    struct Entry
+    {
+        std::uint32_t id;
+        std::uint32_t fingerprint;
+        bool passed;
+        std::uint64_t duration_ns;
+    };
+
+    /* A missing or malformed file leaves the cache empty */
+    void load(const char* path);
+    /* Replaces the file in one rename, false when it cannot be written */
+    bool save(const char* path) const;
+
+    const Entry* find(const TestCaseNode& test) const;
+    /* Records the result of the last execution of test */
+    void update(const TestCaseNode& test);
+
+    bool failed(const TestCaseNode& test) const
+    {
+        const Entry* entry = find(test);
+        return entry != nullptr && !entry->passed;
+    }
+
+    /* Passed last time and its source file did not change since */
+    bool unchanged(const TestCaseNode& test) const
+    {
+        const Entry* entry = find(test);
+        return entry != nullptr && entry->passed && entry->fingerprint == test.fingerprint();
+    }
+
+private:
+    /* Sorted by id */
+    std::vector<Entry> entries_;
+};
+
+} // namespace detail
+} // namespace mstest
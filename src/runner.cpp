@@ -22,63 +22,932 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <csetjmp>
+#include <cstddef>
 #include <cstdio>
+#include <new>
 #include <string_view>
 
+#include "mstest/allocations.hpp"
+#include "mstest/detail/context.hpp"
 #include "mstest/detail/testlist.hpp"
-#include "mstest/detail/colors.hpp"
-#include "mstest/detail/symbols.hpp"
-#include "mstest/detail/testlist.hpp"
+
+#include "mstest/runner.hpp"
+#include "mstest/server.hpp"
+
+#include "filter.hpp"
+#include "latency_histogram.hpp"
+#include "runner_internal.hpp"
+
+#if defined(MSTEST_HOST)
+#include <mutex>
+
+#include <unistd.h>
+
+#include "watchdog.hpp"
+#endif
 
 namespace mstest
 {
+namespace detail
+{
 
-int run_tests()
+namespace
+{
+
+Reporter& select_reporter(const Options& options)
+{
+    if (options.reporter != nullptr)
+    {
+        return *options.reporter;
+    }
+    switch (options.format)
+    {
+        case Format::binary:
+            return binary_reporter();
+        case Format::junit:
+            return junit_reporter();
+        case Format::json:
+            return json_reporter();
+        case Format::console:
+            break;
+    }
+    return console_reporter();
+}
+
+/* Storage fixtures are constructed in, one per runner thread and reused by
+ * every test, so peak memory is the largest fixture rather than all of them */
+class FixtureArena
+{
+public:
+#if defined(MSTEST_HOST)
+    ~FixtureArena()
+    {
+        ::operator delete(data_, std::align_val_t(align_));
+    }
+
+    /* Grows to the largest fixture seen so far, never shrinks */
+    void* reserve(const TestCaseNode& test)
+    {
+        if (test.fixture_size() > size_ || test.fixture_align() > align_)
+        {
+            ::operator delete(data_, std::align_val_t(align_));
+            size_ = std::max(size_, test.fixture_size());
+            align_ = std::max(align_, test.fixture_align());
+            data_ = ::operator new(size_, std::align_val_t(align_));
+        }
+        return data_;
+    }
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t align_ = alignof(std::max_align_t);
+#else
+    /* Fixture size is checked when the test is declared */
+    void* reserve(const TestCaseNode&)
+    {
+        return data_;
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char data_[MSTEST_FIXTURE_ARENA_SIZE];
+#endif
+};
+
+/* Keeps tests sorted by key, largest first, at most limit of them */
+template <class Key>
+void rank(const TestCaseNode** tests, std::size_t& count, std::size_t limit, const TestCaseNode& test, Key key)
+{
+    std::size_t position = count;
+    while (position > 0 && key(*tests[position - 1]) < key(test))
+    {
+        if (position < limit)
+        {
+            tests[position] = tests[position - 1];
+        }
+        --position;
+    }
+    if (position < limit)
+    {
+        tests[position] = &test;
+        if (count < limit)
+        {
+            ++count;
+        }
+    }
+}
+
+#if defined(MSTEST_HOST)
+/* Fails test when it ran slower than its baseline allows and describes
+ * by how much in note */
+bool regressed(TestCaseNode& test, const TestRecord& record, const Report& report, char* note, std::size_t size)
+{
+    const Options& options = report.options;
+    if (options.baseline_file == nullptr || options.update_baseline || !test.result().passed)
+    {
+        return false;
+    }
+    const Baseline::Entry* entry = report.baseline.find(test);
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    const double baseline_ns = entry->median_ns();
+    if (record.benchmark.iterations == 0 && baseline_ns < MSTEST_BASELINE_MIN_NS)
+    {
+        return false;
+    }
+    const double timing_ns = Baseline::timing_ns(test, record);
+    if (timing_ns * 100 <= baseline_ns * (100 + options.baseline_tolerance_percent))
+    {
+        return false;
+    }
+
+    TestResult result = test.result();
+    result.passed = false;
+    test.result(result);
+    snprintf(note, size, "%.1f ns, baseline %.1f ns (+%.0f%%, tolerance %u%%)", timing_ns, baseline_ns,
+        (timing_ns / baseline_ns - 1) * 100, static_cast<unsigned>(options.baseline_tolerance_percent));
+    return true;
+}
+
+/* Shard the plan assigns test to, by index when the plan does not know
+ * it or was made for more shards */
+bool planned_in_shard(const Report& report, const TestCaseNode& test, std::size_t index)
+{
+    const Options& options = report.options;
+    const ShardPlan::Entry* entry = options.shard_plan_file != nullptr ? report.plan.find(test) : nullptr;
+    if (entry != nullptr && entry->shard < options.shard_count)
+    {
+        return entry->shard == options.shard_index;
+    }
+    return in_shard(index, options);
+}
+#endif
+
+#if !defined(MSTEST_HOST)
+/* Consecutive tests sharing suite hooks */
+struct HookedRun
+{
+    const SuiteHooks* hooks = nullptr;
+    TestList::TestListIterator first{nullptr};
+    std::size_t count = 0;
+    /* Tests passing the filters before the run, as sharding counts them,
+     * and within it */
+    std::size_t index = 0;
+    std::size_t passing = 0;
+    /* Its suite runs from here, it had the first test of the shard */
+    bool gathers = false;
+};
+
+/* Calls visit for the tests of the shard in the order they run. Tests of
+ * a suite with hooks run right after the first of them, wherever they are
+ * registered, so the hooks run once. The runs of such tests are collected
+ * in one pass up front, so gathering a suite only looks at the runs. */
+template <class Visit>
+void for_each_selected(const Options& options, Visit visit)
+{
+    TestList& list = TestList::get();
+    HookedRun runs[MSTEST_HOOKED_RUNS];
+    std::size_t run_count = 0;
+    std::size_t index = 0;
+    const SuiteHooks* previous = nullptr;
+    for (auto it = list.begin(); it != list.end(); ++it)
+    {
+        TestCaseNode& test = *it;
+        const SuiteHooks* const hooks = test.suite_hooks();
+        if (hooks != nullptr && (previous == nullptr || !same_suite(previous, hooks)))
+        {
+            if (run_count == MSTEST_HOOKED_RUNS)
+            {
+                break;
+            }
+            runs[run_count++] = HookedRun{hooks, it, 0, index, 0, false};
+        }
+        previous = hooks;
+        const bool passes = passes_filters(test, options);
+        if (hooks != nullptr)
+        {
+            ++runs[run_count - 1].count;
+            runs[run_count - 1].passing += passes ? 1 : 0;
+        }
+        index += passes ? 1 : 0;
+    }
+
+    /* True when any test of run was in the shard */
+    auto visit_run = [&options, &visit](const HookedRun& run) {
+        bool visited = false;
+        std::size_t run_index = run.index;
+        auto it = run.first;
+        for (std::size_t i = 0; i < run.count; ++i, ++it)
+        {
+            if (passes_filters(*it, options) && in_shard(run_index++, options))
+            {
+                visit(*it);
+                visited = true;
+            }
+        }
+        return visited;
+    };
+
+    index = 0;
+    std::size_t next_run = 0;
+    for (auto it = list.begin(); it != list.end();)
+    {
+        if (next_run < run_count && !(runs[next_run].first != it))
+        {
+            HookedRun& run = runs[next_run];
+            bool gathered = false;
+            for (std::size_t earlier = 0; earlier < next_run && !gathered; ++earlier)
+            {
+                gathered = runs[earlier].gathers && same_suite(runs[earlier].hooks, run.hooks);
+            }
+            if (!gathered && visit_run(run))
+            {
+                run.gathers = true;
+                for (std::size_t later = next_run + 1; later < run_count; ++later)
+                {
+                    if (same_suite(runs[later].hooks, run.hooks))
+                    {
+                        visit_run(runs[later]);
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < run.count; ++i)
+            {
+                ++it;
+            }
+            index = run.index + run.passing;
+            ++next_run;
+            continue;
+        }
+
+        TestCaseNode& test = *it;
+        if (passes_filters(test, options) && in_shard(index++, options))
+        {
+            visit(test);
+        }
+        ++it;
+    }
+}
+#endif
+
+const Options* active_options = nullptr;
+
+#if defined(MSTEST_HOST)
+/* Report of the run in progress, the watchdog finishes it when a test
+ * hangs. Written under report_mutex only. */
+std::mutex report_mutex;
+Report* active_report = nullptr;
+#endif
+
+#if defined(MSTEST_HOST)
+/* Formats meant for tools get stdout to themselves, anything written to
+ * stdout meanwhile goes to stderr. Returns the stream of the former
+ * stdout, nullptr when it cannot be set up. */
+FILE* take_stdout()
+{
+    fflush(stdout);
+    const int report_fd = dup(STDOUT_FILENO);
+    if (report_fd < 0)
+    {
+        return nullptr;
+    }
+    FILE* const stream = fdopen(report_fd, "w");
+    if (stream == nullptr)
+    {
+        close(report_fd);
+        return nullptr;
+    }
+    if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        fclose(stream);
+        return nullptr;
+    }
+    return stream;
+}
+
+void release_stdout(FILE* stream)
+{
+    fflush(stdout);
+    dup2(fileno(stream), STDOUT_FILENO);
+    fclose(stream);
+}
+#endif
+
+/* Held while the report is written, so the watchdog does not finish it
+ * at the same time. Nothing to guard without threads. */
+class ReportLock
+{
+public:
+#if defined(MSTEST_HOST)
+    ReportLock()
+        : lock_(report_mutex)
+    {
+    }
+
+private:
+    std::lock_guard<std::mutex> lock_;
+#else
+    ReportLock()
+    {
+    }
+#endif
+};
+
+/* Suite whose setup_suite() ran last on this thread and whose
+ * teardown_suite() is still due */
+MSTEST_THREAD_LOCAL const SuiteHooks* active_suite = nullptr;
+
+/* Stands in for a test while a suite hook runs, so its expectations have
+ * a test to fail */
+class SuiteHookTest final : public mstest::Test
+{
+    void execute() override
+    {
+    }
+};
+
+/* False when hook failed, what it recorded goes to the record in use */
+bool run_suite_hook(SuiteHook hook)
+{
+    if (hook == nullptr)
+    {
+        return true;
+    }
+    Context& context = Context::get();
+    SuiteHookTest stand_in;
+    /* Live across setjmp() */
+    mstest::Test* const volatile test = context.current_test();
+    context.current_test(&stand_in);
+    std::jmp_buf escape;
+    std::jmp_buf* const volatile outer = context.escape(&escape);
+    if (setjmp(escape) == 0)
+    {
+        hook();
+    }
+    context.escape(outer);
+    context.current_test(test);
+    return stand_in.is_passed();
+}
+
+/* Reports the suite if it changed, then all events of a finished test */
+void write_test(TestCaseNode& test, const TestRecord& record, Report& report, const char* note_title, const char* note)
+{
+#if defined(MSTEST_HOST)
+    /* Runner side notes, e.g. a crash, leave no timing to compare */
+    char regression[96];
+    if (note_title == nullptr && regressed(test, record, report, regression, sizeof(regression)))
+    {
+        note_title = "Performance regression";
+        note = regression;
+    }
+#endif
+
+    Reporter& reporter = report.reporter;
+    if (report.suite == nullptr || std::string_view(report.suite) != std::string_view(test.suite()))
+    {
+        report.suite = test.suite();
+        reporter.suite_start(report.output, report.suite);
+    }
+
+    reporter.test_start(report.output, test);
+    for (const FailureRecord& failure : record.failures)
+    {
+        reporter.failure(report.output, test, failure);
+    }
+    if (note_title != nullptr)
+    {
+        reporter.note(report.output, test, note_title, note);
+    }
+    reporter.test_end(report.output, test, record);
+
+    Summary& summary = report.summary;
+    const TestResult& result = test.result();
+    if (result.passed)
+    {
+        ++summary.passed;
+    }
+    ++summary.executed;
+
+    rank(summary.slowest, summary.slowest_count, report.slowest_limit, test,
+        [](const TestCaseNode& ranked) { return ranked.result().total_ns(); });
+
+#if defined(MSTEST_HOST)
+    if (report.options.cache_file != nullptr)
+    {
+        report.cache.update(test);
+    }
+    if (report.options.update_baseline && result.passed)
+    {
+        report.baseline.update(test, record);
+    }
+#endif
+
+    if (record.repeat.unstable() && summary.unstable_count < MSTEST_MAX_UNSTABLE)
+    {
+        summary.unstable[summary.unstable_count++] = Summary::Unstable{&test, record.repeat};
+    }
+
+    summary.counters += result.counters;
+    summary.allocations += result.heap.allocations;
+    if (result.heap.allocations != 0)
+    {
+        rank(summary.most_allocating, summary.most_allocating_count, report.slowest_limit, test,
+            [](const TestCaseNode& ranked) { return ranked.result().heap.allocations; });
+    }
+}
+
+} // namespace
+
+const Options& run_options()
+{
+    static const Options defaults;
+    return active_options != nullptr ? *active_options : defaults;
+}
+
+Output& report_output()
+{
+    static Output output;
+    return output;
+}
+
+Report::Report(const Options& options)
+    : options(options)
+    , reporter(select_reporter(options))
+    , output(report_output())
+    , slowest_limit(options.slowest < MSTEST_MAX_SLOWEST ? options.slowest : MSTEST_MAX_SLOWEST)
 {
-    printf ("%s<---    Executing tests    --->%s\n", detail::color::blue, detail::color::reset);
-    int passed_tests = 0;
-    int executed_tests = 0;
-    int return_code = 0;
-    const char* suite = "";
+    output.destination(options.write);
+    active_options = &options;
+#if defined(MSTEST_HOST)
+    if (options.reporter == nullptr && options.format != Format::console && options.write == nullptr)
+    {
+        stream = take_stdout();
+        output.stream(stream);
+    }
+    {
+        ReportLock lock;
+        active_report = this;
+    }
+    if (options.cache_file != nullptr)
+    {
+        cache.load(options.cache_file);
+    }
+    if (options.baseline_file != nullptr)
+    {
+        baseline.load(options.baseline_file);
+    }
+    if (options.shard_plan_file != nullptr)
+    {
+        plan.load(options.shard_plan_file);
+    }
+#endif
+}
 
-    suite = "";
-    for (auto& test : mstest::detail::TestList::get())
+Report::~Report()
+{
+    ReportLock lock;
+    active_options = nullptr;
+    output.flush();
+#if defined(MSTEST_HOST)
+    active_report = nullptr;
+    if (stream != nullptr)
     {
-        if (std::string_view(suite) != std::string_view(test.suite()))
+        output.stream(nullptr);
+        release_stdout(stream);
+    }
+#endif
+}
+
+bool enter_suite(const TestCaseNode& test)
+{
+    if (same_suite(active_suite, test.suite_hooks()))
+    {
+        return true;
+    }
+    const bool passed = leave_suite();
+    active_suite = test.suite_hooks();
+    return run_suite_hook(active_suite != nullptr ? active_suite->setup : nullptr) && passed;
+}
+
+bool leave_suite()
+{
+    const SuiteHooks* const hooks = active_suite;
+    active_suite = nullptr;
+    return hooks == nullptr || run_suite_hook(hooks->teardown);
+}
+
+const TestResult& run_test(TestCaseNode& test, bool last_in_suite)
+{
+    static MSTEST_THREAD_LOCAL FixtureArena arena;
+    Context::get().reset();
+    /* Suite state outlives the test, its hooks are neither timed nor
+     * tracked as allocations of the test */
+    bool suite_passed = enter_suite(test);
+#if defined(MSTEST_HOST)
+    watchdog_arm(test);
+#endif
+    /* Arena growth belongs to the runner, not to the test */
+    void* storage = arena.reserve(test);
+    start_allocation_tracking();
+    TestResult result = test.execute(storage);
+    result.heap = stop_allocation_tracking();
+#if defined(MSTEST_HOST)
+    watchdog_disarm();
+#endif
+    if (last_in_suite)
+    {
+        suite_passed = leave_suite() && suite_passed;
+    }
+    /* The fixture is destroyed by now, anything still allocated leaked */
+    if (result.heap.leaked_blocks() != 0 || !suite_passed)
+    {
+        result.passed = false;
+    }
+    test.result(result);
+    return test.result();
+}
+
+const TestResult& run_repeated(TestCaseNode& test, bool last_in_suite)
+{
+    const Options& options = run_options();
+    if (!repeating(options))
+    {
+        return run_test(test, last_in_suite);
+    }
+
+    static MSTEST_THREAD_LOCAL LatencyHistogram histogram;
+    /* What the first failed run recorded, later runs record over it */
+    static MSTEST_THREAD_LOCAL TestRecord failed_record;
+    histogram.clear();
+    Context& context = Context::get();
+    RepeatStats stats;
+    TestResult kept;
+    const std::uint64_t start = Clock::now();
+    const std::uint64_t duration_ns = static_cast<std::uint64_t>(options.repeat_for_ms) * 1000000u;
+    for (;;)
+    {
+        /* The suite stays set up between runs */
+        const TestResult& result = run_test(test, false);
+        ++stats.runs;
+        histogram.record(result.total_ns());
+        if (!result.passed)
         {
-            suite = test.suite();
-            printf("%s -> Suite: %s%s\n", detail::color::blue, suite, detail::color::reset);
+            if (stats.failures++ == 0)
+            {
+                kept = result;
+                failed_record = context.record();
+            }
         }
-        mstest::detail::TestList::get().current_test(test.test());
-        if(!test.execute())
+        else if (stats.failures == 0)
         {
-            ++return_code;
+            kept = result;
+        }
 
-            printf("%s  x  %-50s %s\n", detail::color::red, test.testcase(), detail::color::reset);
+        if (stats.failures != 0 && options.max_failures != 0)
+        {
+            break;
         }
-        else
+        const bool done = duration_ns != 0 ? Clock::to_ns(Clock::now() - start) >= duration_ns : stats.runs >= options.repeat;
+        if (done)
         {
-            ++passed_tests;
-            printf("%s  %s  %-50s %s\n", detail::color::green, detail::symbols::check_mark, test.testcase(), detail::color::reset);
+            break;
+        }
+    }
+
+    if (stats.failures != 0)
+    {
+        context.record(failed_record);
+    }
+    if (last_in_suite && !leave_suite())
+    {
+        kept.passed = false;
+    }
+    stats.p50_ns = histogram.percentile(50);
+    stats.p99_ns = histogram.percentile(99);
+    stats.max_ns = histogram.max();
+    context.repeat(stats);
+    test.result(kept);
+    return test.result();
+}
 
+void report_start(Report& report, std::size_t tests)
+{
+    ReportLock lock;
+    report.tests = tests;
+    report.reporter.run_start(report.output, report.options, tests);
+}
+
+void report_test(TestCaseNode& test, const TestRecord& record, Report& report, const char* note_title, const char* note)
+{
+    ReportLock lock;
+    write_test(test, record, report, note_title, note);
+}
+
+int report_summary(Report& report)
+{
+    {
+        ReportLock lock;
+        report.reporter.run_end(report.output, report.summary);
+        report.output.flush();
+    }
+#if defined(MSTEST_HOST)
+    if (report.options.cache_file != nullptr && !report.cache.save(report.options.cache_file))
+    {
+        fprintf(stderr, "mstest: unable to write result cache %s\n", report.options.cache_file);
+    }
+    if (report.options.update_baseline && !report.baseline.save(report.options.baseline_file))
+    {
+        fprintf(stderr, "mstest: unable to write baseline %s\n", report.options.baseline_file);
+    }
+#endif
+    return report.summary.executed - report.summary.passed;
+}
+
+void report_flush(Report& report)
+{
+    if (report.options.reporter != nullptr || report.options.format != Format::console)
+    {
+        return;
+    }
+    ReportLock lock;
+    report.output.flush();
+}
+
+#if defined(MSTEST_HOST)
+void report_hang(TestCaseNode& test, std::uint32_t limit_ms)
+{
+    std::lock_guard<std::mutex> lock(report_mutex);
+    if (active_report == nullptr)
+    {
+        return;
+    }
+    Report& report = *active_report;
+
+    /* The test is still running on its thread, nothing it recorded is
+     * safe to read */
+    static TestRecord record;
+    TestResult result;
+    result.timed_out = true;
+    result.budget_ms = limit_ms;
+    result.execute_ns = static_cast<std::uint64_t>(limit_ms) * 1000000u;
+    test.result(result);
+    write_test(test, record, report, "Run aborted", "the test hung, tests after it are not reported");
+
+    const int unreported = static_cast<int>(report.tests) - report.summary.executed;
+    report.summary.skipped += unreported > 0 ? unreported : 0;
+    report.reporter.run_end(report.output, report.summary);
+    report.output.flush();
+}
+#endif
+
+int list_tests(const Options& options)
+{
+#if defined(MSTEST_HOST)
+    /* The report holds what the order depends on: cache and shard plan */
+    Report report(options);
+    for (const TestCaseNode* test : selected_tests(report))
+    {
+        report.output.print("%s.%s\n", test->suite(), test->testcase());
+    }
+#else
+    Output& output = report_output();
+    output.destination(options.write);
+    for_each_selected(options, [&output](TestCaseNode& test) { output.print("%s.%s\n", test.suite(), test.testcase()); });
+    output.flush();
+#endif
+    return 0;
+}
+
+#if defined(MSTEST_HOST)
+bool ends_suite(const std::vector<TestCaseNode*>& tests, std::size_t i)
+{
+    return i + 1 == tests.size() || !same_suite(tests[i]->suite_hooks(), tests[i + 1]->suite_hooks());
+}
+
+std::size_t group_end(const std::vector<TestCaseNode*>& tests, std::size_t begin)
+{
+    const SuiteHooks* const hooks = tests[begin]->suite_hooks();
+    if (hooks == nullptr)
+    {
+        return async_group_end(tests, begin);
+    }
+    std::size_t end = begin + 1;
+    while (end < tests.size() && same_suite(tests[end]->suite_hooks(), hooks))
+    {
+        ++end;
+    }
+    return end;
+}
+
+std::vector<TestCaseNode*> selected_tests(Report& report)
+{
+    const Options& options = report.options;
+    const bool skip_unchanged = options.cache_file != nullptr && options.skip_unchanged;
+    std::vector<TestCaseNode*> tests;
+    std::size_t index = 0;
+    for_each_passing(options, [&](TestCaseNode& test) {
+        if (!planned_in_shard(report, test, index++))
+        {
+            return;
+        }
+        if (skip_unchanged && report.cache.unchanged(test))
+        {
+            ++report.summary.skipped;
+            return;
         }
-        ++executed_tests;
+        tests.push_back(&test);
+    });
+
+    if (options.cache_file != nullptr && options.failed_first)
+    {
+        /* Quickest failures first, the rest keeps registration order */
+        const ResultCache& cache = report.cache;
+        const auto passing = std::stable_partition(tests.begin(), tests.end(),
+            [&cache](const TestCaseNode* test) { return cache.failed(*test); });
+        std::stable_sort(tests.begin(), passing, [&cache](const TestCaseNode* a, const TestCaseNode* b) {
+            return cache.find(*a)->duration_ns < cache.find(*b)->duration_ns;
+        });
     }
 
-    printf("%s ----------------------------%s\n", detail::color::blue, detail::color::reset);
-    printf("%s|%s Executed tests: %10d%s |%s\n", detail::color::blue, detail::color::reset, executed_tests, detail::color::blue, detail::color::reset);
+    /* Tests of a suite with hooks move up behind its first test, so the
+     * hooks run once even when the suite is spread over several
+     * translation units */
+    std::vector<std::pair<const SuiteHooks*, std::size_t>> suites;
+    std::vector<std::pair<std::size_t, TestCaseNode*>> keyed;
+    for (std::size_t i = 0; i < tests.size(); ++i)
+    {
+        const SuiteHooks* const hooks = tests[i]->suite_hooks();
+        std::size_t key = i;
+        if (hooks != nullptr)
+        {
+            const auto suite = std::find_if(suites.begin(), suites.end(),
+                [hooks](const std::pair<const SuiteHooks*, std::size_t>& known) { return same_suite(known.first, hooks); });
+            if (suite != suites.end())
+            {
+                key = suite->second;
+            }
+            else
+            {
+                suites.emplace_back(hooks, i);
+            }
+        }
+        keyed.emplace_back(key, tests[i]);
+    }
+    if (!suites.empty())
+    {
+        std::stable_sort(keyed.begin(), keyed.end(),
+            [](const std::pair<std::size_t, TestCaseNode*>& a, const std::pair<std::size_t, TestCaseNode*>& b) { return a.first < b.first; });
+        for (std::size_t i = 0; i < tests.size(); ++i)
+        {
+            tests[i] = keyed[i].second;
+        }
+    }
+    return tests;
+}
 
-    const char* color = mstest::detail::color::green;
-    if (executed_tests - passed_tests != 0)
+int write_manifest(const Options& options)
+{
+    ResultCache durations;
+    const char* durations_file = options.durations_file != nullptr ? options.durations_file : options.cache_file;
+    if (durations_file != nullptr)
     {
-        color = mstest::detail::color::red;
+        durations.load(durations_file);
     }
 
-    printf("%s|%s Passed tests  : %10d%s |%s\n", detail::color::blue, detail::color::green, passed_tests, mstest::detail::color::blue, mstest::detail::color::reset);
-    printf("%s|%s Failed tests  : %10d%s |%s\n", detail::color::blue, color, executed_tests - passed_tests, detail::color::blue, mstest::detail::color::reset);
-    printf("%s ----------------------------%s\n", detail::color::blue, detail::color::reset);
+    std::vector<TestCaseNode*> tests;
+    for_each_passing(options, [&tests](TestCaseNode& test) { tests.push_back(&test); });
+
+    ShardPlan plan;
+    plan.build(tests, durations, options.shard_count);
+    Output& output = report_output();
+    output.destination(options.write);
+    plan.write(output, tests);
+    output.flush();
+    return 0;
+}
+#endif
+
+} // namespace detail
+
+int run_tests()
+{
+    return run_tests(Options{});
+}
 
-    return return_code;
+int run_tests(const Options& options)
+{
+    if (options.list)
+    {
+        return detail::list_tests(options);
+    }
+#if defined(MSTEST_HOST)
+    if (options.manifest)
+    {
+        return detail::write_manifest(options);
+    }
+    if (options.isolate)
+    {
+        return detail::run_isolated(options);
+    }
+    if (options.jobs != 1)
+    {
+        return detail::run_parallel(options);
+    }
+#endif
+
+#if defined(MSTEST_HOST)
+    detail::Watchdog watchdog(options.hang_timeout_ms);
+    detail::Watchdog::Watch watch(watchdog);
+
+    detail::Report report(options);
+    const std::vector<detail::TestCaseNode*> tests = detail::selected_tests(report);
+    detail::report_start(report, tests.size());
+
+    std::vector<detail::TestRecord> records;
+    for (std::size_t i = 0; i < tests.size();)
+    {
+        if (detail::failure_limit_reached(report))
+        {
+            report.summary.skipped += static_cast<int>(tests.size() - i);
+            break;
+        }
+        /* What tests and suite hooks print lands behind the console report */
+        detail::report_flush(report);
+        const std::size_t end = detail::async_group_end(tests, i);
+        if (end - i == 1)
+        {
+            detail::run_repeated(*tests[i], detail::ends_suite(tests, i));
+            detail::report_test(*tests[i], detail::Context::get().record(), report);
+            ++i;
+            continue;
+        }
+
+        records.assign(end - i, detail::TestRecord{});
+        detail::run_async_group(&tests[i], end - i, records.data(), detail::ends_suite(tests, end - 1));
+        for (std::size_t member = 0; i < end && !detail::failure_limit_reached(report); ++i, ++member)
+        {
+            detail::report_test(*tests[i], records[member], report);
+        }
+    }
+    /* Still up when the failure limit stopped the run within a suite */
+    detail::leave_suite();
+#else
+    std::size_t selected = detail::count_passing(options);
+    selected = selected / options.shard_count + (selected % options.shard_count > options.shard_index ? 1 : 0);
+
+    detail::Report report(options);
+    detail::report_start(report, selected);
+
+    /* A test runs once the next one is known, which tells whether it is
+     * the last of its suite */
+    detail::TestCaseNode* pending = nullptr;
+    auto run_pending = [&report, &pending](const detail::TestCaseNode* next) {
+        if (pending == nullptr || detail::failure_limit_reached(report))
+        {
+            return;
+        }
+        /* What tests and suite hooks print lands behind the console report */
+        detail::report_flush(report);
+        detail::run_repeated(*pending, next == nullptr || !detail::same_suite(pending->suite_hooks(), next->suite_hooks()));
+        detail::report_test(*pending, detail::Context::get().record(), report);
+    };
+    detail::for_each_selected(options, [&run_pending, &pending](detail::TestCaseNode& test) {
+        run_pending(&test);
+        pending = &test;
+    });
+    run_pending(nullptr);
+    detail::leave_suite();
+    report.summary.skipped = static_cast<int>(selected) - report.summary.executed;
+#endif
+
+    return detail::report_summary(report);
+}
+
+int run_tests(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        return -1;
+    }
+    if (options.serve)
+    {
+        return serve(stdio_channel(), options);
+    }
+    return run_tests(options);
+}
+
+#if defined(MSTEST_HOST)
+int run_tests_parallel(std::size_t threads)
+{
+    Options options;
+    options.jobs = threads;
+    return detail::run_parallel(options);
 }
+#endif
 
 } // namespace mstest
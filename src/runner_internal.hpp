@@ -0,0 +1,166 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#if defined(MSTEST_HOST)
+#include <cstdio>
+#include <vector>
+
+#include "baseline.hpp"
+#include "result_cache.hpp"
+#include "shard_plan.hpp"
+#endif
+
+#include "mstest/detail/testcase_node.hpp"
+#include "mstest/detail/testlist.hpp"
+#include "mstest/options.hpp"
+#include "mstest/output.hpp"
+#include "mstest/reporter.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Options of the run in progress, defaults outside of run_tests() */
+const Options& run_options();
+
+/* Buffer every report is written to */
+Output& report_output();
+
+/* Reporting state of a run, owned by the thread calling run_tests() */
+struct Report
+{
+    explicit Report(const Options& options);
+    ~Report();
+
+    const Options& options;
+    Reporter& reporter;
+    Output& output;
+    Summary summary;
+    const char* suite = nullptr;
+    /* Tests announced by report_start() */
+    std::size_t tests = 0;
+    std::size_t slowest_limit;
+#if defined(MSTEST_HOST)
+    /* Loaded from and saved to Options::cache_file */
+    ResultCache cache;
+    /* Loaded from Options::baseline_file, saved when updated */
+    Baseline baseline;
+    /* Loaded from Options::shard_plan_file */
+    ShardPlan plan;
+    /* Former stdout the report goes to while stdout of the process is
+     * redirected to stderr, nullptr when it is not */
+    std::FILE* stream = nullptr;
+#endif
+};
+
+/* Sets up the suite of test on the calling thread unless it already is,
+ * tearing down the suite set up before. The hooks run as part of test:
+ * what they record goes to the record in use, false when one failed. */
+bool enter_suite(const TestCaseNode& test);
+/* Tears down the suite set up on the calling thread, if any */
+bool leave_suite();
+
+/* Executes test on the calling thread, what it recorded is left in the
+ * context of that thread. Its suite is set up first if needed and torn
+ * down after when last_in_suite, a failed hook fails test. */
+const TestResult& run_test(TestCaseNode& test, bool last_in_suite);
+
+/* True when Options::repeat or repeat_for_ms run tests more than once */
+inline bool repeating(const Options& options)
+{
+    return options.repeat > 1 || options.repeat_for_ms != 0;
+}
+
+/* Runs test as often as the options of the run ask, each time with a
+ * fresh fixture. The context is left with what the first failed run
+ * recorded, or the last run when all passed, and the statistics of all
+ * runs. Same as run_test() when not repeating. */
+const TestResult& run_repeated(TestCaseNode& test, bool last_in_suite);
+
+void report_start(Report& report, std::size_t tests);
+/* Reports the suite if it changed, then all events of a finished test.
+ * note_title and note describe a runner side problem, e.g. a crash. */
+void report_test(TestCaseNode& test, const TestRecord& record, Report& report, const char* note_title = nullptr,
+    const char* note = nullptr);
+int report_summary(Report& report);
+/* Writes out what console text was reported so far, so what the next
+ * test prints follows it. Other formats are left buffered. */
+void report_flush(Report& report);
+
+/* True once Options::max_failures tests failed, runners then stop starting
+ * tests and report the ones left as skipped */
+inline bool failure_limit_reached(const Report& report)
+{
+    const std::size_t failed = static_cast<std::size_t>(report.summary.executed - report.summary.passed);
+    return report.options.max_failures != 0 && failed >= report.options.max_failures;
+}
+
+inline bool in_shard(std::size_t index, const Options& options)
+{
+    return index % options.shard_count == options.shard_index;
+}
+
+/* Prints the names of the tests of the shard in the order they would
+ * run, leaving out those a run would skip as unchanged */
+int list_tests(const Options& options);
+
+#if defined(MSTEST_HOST)
+/* Tests of the shard in the order they run. Tests the cache knows as
+ * unchanged are left out and counted as skipped. */
+std::vector<TestCaseNode*> selected_tests(Report& report);
+
+/* Writes the manifest of the tests passing the filters, see ShardPlan */
+int write_manifest(const Options& options);
+
+/* End of the group of tests starting at begin. Consecutive MSTEST_ASYNC
+ * tests of one suite form a group, any other test is a group of its own. */
+std::size_t async_group_end(const std::vector<TestCaseNode*>& tests, std::size_t begin);
+
+/* Runs a group of async tests interleaved on one scheduler. Fixtures are
+ * set up in order, the bodies run together, then all are torn down. What
+ * each test recorded goes to records[i], results are left in the nodes.
+ * Suite hooks run as with run_test(). */
+void run_async_group(TestCaseNode* const* tests, std::size_t count, TestRecord* records, bool last_in_suite);
+
+/* True when tests[i] is the last test sharing its suite hooks */
+bool ends_suite(const std::vector<TestCaseNode*>& tests, std::size_t i);
+
+/* End of the tests starting at begin one thread has to run together: a
+ * whole suite with hooks, else the async group */
+std::size_t group_end(const std::vector<TestCaseNode*>& tests, std::size_t begin);
+
+/* Finishes the report of the run in progress with test failed as hung,
+ * for the watchdog to call right before it aborts the process. The
+ * reporting thread must not be the one stuck in test. */
+void report_hang(TestCaseNode& test, std::uint32_t limit_ms);
+
+int run_parallel(const Options& options);
+int run_isolated(const Options& options);
+#endif
+
+} // namespace detail
+} // namespace mstest
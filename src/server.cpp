@@ -0,0 +1,258 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "mstest/detail/testlist.hpp"
+#include "mstest/runner.hpp"
+#include "mstest/server.hpp"
+
+#include "filter.hpp"
+
+namespace mstest
+{
+namespace
+{
+
+std::size_t read_stdin(void* data, std::size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    const int c = getchar();
+    if (c == EOF)
+    {
+        return 0;
+    }
+    *static_cast<char*>(data) = static_cast<char>(c);
+    return 1;
+}
+
+void write_stdout(const void* data, std::size_t size)
+{
+    fwrite(data, 1, size, stdout);
+    fflush(stdout);
+}
+
+void send(const Channel& channel, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void send(const Channel& channel, const char* format, ...)
+{
+    char line[64];
+    va_list args;
+    va_start(args, format);
+    const int size = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (size > 0)
+    {
+        channel.write(line, static_cast<std::size_t>(size) < sizeof(line) ? static_cast<std::size_t>(size) : sizeof(line) - 1);
+    }
+}
+
+void send_table(const Channel& channel, const Options& options)
+{
+    send(channel, "#tests %zu\n", detail::count_passing(options));
+    detail::for_each_passing(options, [&channel](detail::TestCaseNode& test) {
+        send(channel, "#test 0x%08x ", static_cast<unsigned>(test.id()));
+        channel.write(test.suite(), strlen(test.suite()));
+        channel.write(".", 1);
+        channel.write(test.testcase(), strlen(test.testcase()));
+        channel.write("\n", 1);
+    });
+}
+
+/* Reads one line without its end, false once the stream ended. Bytes past
+ * the buffer are dropped and flag the line as too long. */
+bool read_line(const Channel& channel, char (&line)[MSTEST_SERVER_LINE_SIZE], bool& too_long)
+{
+    std::size_t size = 0;
+    too_long = false;
+    char c;
+    for (;;)
+    {
+        if (channel.read(&c, 1) == 0)
+        {
+            if (size == 0)
+            {
+                return false;
+            }
+            break;
+        }
+        if (c == '\n')
+        {
+            break;
+        }
+        if (c == '\r')
+        {
+            continue;
+        }
+        if (size + 1 < sizeof(line))
+        {
+            line[size++] = c;
+        }
+        else
+        {
+            too_long = true;
+        }
+    }
+    line[size] = '\0';
+    return true;
+}
+
+/* Splits line in place at blanks, false when there are too many words */
+bool split(char* line, const char** words, std::size_t capacity, std::size_t& count)
+{
+    count = 0;
+    for (char* word = strtok(line, " \t"); word != nullptr; word = strtok(nullptr, " \t"))
+    {
+        if (count == capacity)
+        {
+            return false;
+        }
+        words[count++] = word;
+    }
+    return true;
+}
+
+bool parse_count(const char* text, std::size_t& count)
+{
+    count = 0;
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        if (*c < '0' || *c > '9')
+        {
+            return false;
+        }
+        count = count * 10 + static_cast<std::size_t>(*c - '0');
+    }
+    return *text != '\0';
+}
+
+} // namespace
+
+const Channel& stdio_channel()
+{
+    static const Channel channel{&read_stdin, &write_stdout};
+    return channel;
+}
+
+int serve(const Channel& channel, const Options& options)
+{
+    Options command = options;
+    command.serve = false;
+    command.write = channel.write;
+    int status = 0;
+
+    send_table(channel, command);
+    send(channel, "#ready\n");
+
+    char line[MSTEST_SERVER_LINE_SIZE];
+    /* Command and count of repeat, then the patterns */
+    const char* words[MSTEST_SERVER_MAX_PATTERNS + 2];
+    bool too_long;
+    while (read_line(channel, line, too_long))
+    {
+        std::size_t count;
+        if (too_long)
+        {
+            send(channel, "#error line longer than %zu bytes\n", sizeof(line) - 1);
+            send(channel, "#ready\n");
+            continue;
+        }
+        if (!split(line, words, sizeof(words) / sizeof(words[0]), count))
+        {
+            send(channel, "#error more than %d patterns\n", MSTEST_SERVER_MAX_PATTERNS);
+            send(channel, "#ready\n");
+            continue;
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+
+        const std::string_view name(words[0]);
+        if (name == "stop")
+        {
+            send(channel, "#bye\n");
+            return status;
+        }
+        else if (name == "list" || name == "run")
+        {
+            if (count - 1 > MSTEST_SERVER_MAX_PATTERNS)
+            {
+                send(channel, "#error more than %d patterns\n", MSTEST_SERVER_MAX_PATTERNS);
+            }
+            else
+            {
+                command.filters = words + 1;
+                command.filter_count = count - 1;
+                if (name == "list")
+                {
+                    send_table(channel, command);
+                }
+                else
+                {
+                    status = run_tests(command);
+                    send(channel, "#done %d\n", status);
+                }
+            }
+        }
+        else if (name == "repeat")
+        {
+            std::size_t repeats;
+            if (count < 2 || !parse_count(words[1], repeats))
+            {
+                send(channel, "#error repeat needs a count\n");
+            }
+            else
+            {
+                command.filters = words + 2;
+                command.filter_count = count - 2;
+                std::size_t runs = 0;
+                status = 0;
+                while (runs < repeats && status == 0)
+                {
+                    status = run_tests(command);
+                    ++runs;
+                }
+                send(channel, "#done %d %zu\n", status, runs);
+            }
+        }
+        else
+        {
+            send(channel, "#error unknown command %.32s\n", words[0]);
+        }
+        command.filters = nullptr;
+        command.filter_count = 0;
+        send(channel, "#ready\n");
+    }
+    return status;
+}
+
+} // namespace mstest
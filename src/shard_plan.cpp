@@ -0,0 +1,131 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+#include "shard_plan.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+/* First line of the file, the number is bumped when the format changes */
+constexpr const char* manifest_header = "mstest manifest 1\n";
+
+bool by_id(const ShardPlan::Entry& entry, std::uint32_t id)
+{
+    return entry.id < id;
+}
+
+} // namespace
+
+void ShardPlan::build(const std::vector<TestCaseNode*>& tests, const ResultCache& durations, std::size_t shard_count)
+{
+    entries_.clear();
+    std::uint64_t known_ns = 0;
+    std::size_t known = 0;
+    for (const TestCaseNode* test : tests)
+    {
+        const ResultCache::Entry* entry = durations.find(*test);
+        entries_.push_back(Entry{test->id(), 0, entry != nullptr ? entry->duration_ns : 0});
+        if (entry != nullptr)
+        {
+            known_ns += entry->duration_ns;
+            ++known;
+        }
+    }
+    const std::uint64_t unknown_ns = known != 0 ? known_ns / known : 1;
+    for (std::size_t i = 0; i < tests.size(); ++i)
+    {
+        if (durations.find(*tests[i]) == nullptr)
+        {
+            entries_[i].duration_ns = unknown_ns;
+        }
+    }
+
+    /* Equally long tests keep registration order, so every machine plans
+     * the same shards from the same durations */
+    std::stable_sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.duration_ns > b.duration_ns; });
+    std::vector<std::uint64_t> loads(shard_count, 0);
+    for (Entry& entry : entries_)
+    {
+        const auto lightest = std::min_element(loads.begin(), loads.end());
+        entry.shard = static_cast<std::uint32_t>(lightest - loads.begin());
+        *lightest += entry.duration_ns;
+    }
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+}
+
+void ShardPlan::load(const char* path)
+{
+    entries_.clear();
+    FILE* file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    char header[32];
+    if (fgets(header, sizeof(header), file) != nullptr && std::string(header) == manifest_header)
+    {
+        /* shard, id, duration, then the name up to the end of the line */
+        Entry entry;
+        while (fscanf(file, "%" SCNu32 " %" SCNx32 " %" SCNu64 "%*[^\n]", &entry.shard, &entry.id, &entry.duration_ns) == 3)
+        {
+            entries_.push_back(entry);
+        }
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    }
+    fclose(file);
+}
+
+void ShardPlan::write(Output& output, const std::vector<TestCaseNode*>& tests) const
+{
+    output.print("%s", manifest_header);
+    for (const TestCaseNode* test : tests)
+    {
+        const Entry* entry = find(*test);
+        if (entry != nullptr)
+        {
+            output.print("%" PRIu32 " %08" PRIx32 " %" PRIu64 " %s.%s\n", entry->shard, entry->id, entry->duration_ns, test->suite(),
+                test->testcase());
+        }
+    }
+}
+
+const ShardPlan::Entry* ShardPlan::find(const TestCaseNode& test) const
+{
+    const std::uint32_t id = test.id();
+    const auto entry = std::lower_bound(entries_.begin(), entries_.end(), id, by_id);
+    return entry != entries_.end() && entry->id == id ? &*entry : nullptr;
+}
+
+} // namespace detail
+} // namespace mstest
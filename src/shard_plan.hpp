@@ -0,0 +1,72 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mstest/detail/testcase_node.hpp"
+#include "mstest/output.hpp"
+
+#include "result_cache.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Assignment of tests to shards balanced by their durations, written as a
+ * manifest so every CI machine runs the same plan. Longest tests are
+ * placed first, each on the shard with the least work so far. */
+class ShardPlan
+{
+public:
+    struct Entry
+    {
+        std::uint32_t id;
+        std::uint32_t shard;
+        std::uint64_t duration_ns;
+    };
+
+    /* Plans tests over shard_count shards. Tests without a duration in
+     * durations count as long as the average test that has one. */
+    void build(const std::vector<TestCaseNode*>& tests, const ResultCache& durations, std::size_t shard_count);
+
+    /* A missing or malformed file leaves the plan empty */
+    void load(const char* path);
+    /* Lists tests in registration order with their shard, id, planned
+     * duration and name */
+    void write(Output& output, const std::vector<TestCaseNode*>& tests) const;
+
+    const Entry* find(const TestCaseNode& test) const;
+
+private:
+    /* Sorted by id */
+    std::vector<Entry> entries_;
+};
+
+} // namespace detail
+} // namespace mstest
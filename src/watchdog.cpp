@@ -0,0 +1,146 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "watchdog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "mstest/detail/colors.hpp"
+
+#include "runner_internal.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+thread_local Watchdog::Watch* thread_watch = nullptr;
+
+} // namespace
+
+Watchdog::Watch::Watch(Watchdog& watchdog)
+    : watchdog_(watchdog)
+{
+    std::lock_guard<std::mutex> lock(watchdog_.mutex_);
+    watchdog_.watches_.push_back(this);
+    thread_watch = this;
+}
+
+Watchdog::Watch::~Watch()
+{
+    std::lock_guard<std::mutex> lock(watchdog_.mutex_);
+    watchdog_.watches_.erase(std::find(watchdog_.watches_.begin(), watchdog_.watches_.end(), this));
+    thread_watch = nullptr;
+}
+
+void Watchdog::Watch::arm(TestCaseNode& test)
+{
+    /* Going over the budget only fails the test, the process is aborted
+     * once it is clear the test will not come back */
+    std::uint32_t limit = watchdog_.hang_timeout_ms_;
+    if (limit == 0 && test.timeout_ms() != 0)
+    {
+        limit = test.timeout_ms() + MSTEST_WATCHDOG_GRACE_MS;
+    }
+    if (limit == 0)
+    {
+        return;
+    }
+    test_ = &test;
+    limit_ms_ = limit;
+    deadline_ = now_ms() + limit;
+}
+
+void Watchdog::Watch::disarm()
+{
+    deadline_ = 0;
+}
+
+Watchdog::Watchdog(std::uint32_t hang_timeout_ms)
+    : hang_timeout_ms_(hang_timeout_ms)
+    , thread_([this] { monitor(); })
+{
+}
+
+Watchdog::~Watchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wakeup_.notify_one();
+    thread_.join();
+}
+
+std::int64_t Watchdog::now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(clock::now().time_since_epoch()).count();
+}
+
+void Watchdog::monitor()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wakeup_.wait_for(lock, std::chrono::milliseconds(10), [this] { return stop_; }))
+    {
+        const std::int64_t now = now_ms();
+        for (Watch* watch : watches_)
+        {
+            const std::int64_t deadline = watch->deadline_;
+            if (deadline == 0 || now < deadline)
+            {
+                continue;
+            }
+            TestCaseNode* test = watch->test_;
+            const std::uint32_t limit_ms = watch->limit_ms_;
+            fprintf(stderr, "\n%s  x  %s.%s still running after %u ms, aborting%s\n", color::red, test->suite(),
+                test->testcase(), static_cast<unsigned>(limit_ms), color::reset);
+            /* Results so far and the summary are still buffered */
+            report_hang(*test, limit_ms);
+            std::_Exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void watchdog_arm(TestCaseNode& test)
+{
+    if (thread_watch != nullptr)
+    {
+        thread_watch->arm(test);
+    }
+}
+
+void watchdog_disarm()
+{
+    if (thread_watch != nullptr)
+    {
+        thread_watch->disarm();
+    }
+}
+
+} // namespace detail
+} // namespace mstest
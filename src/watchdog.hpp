@@ -0,0 +1,98 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mstest/detail/testcase_node.hpp"
+
+/* Without a hang timeout a test with a MSTEST_TIMEOUT budget is taken
+ * as hung that long after its budget ran out. A test merely over budget
+ * comes back and fails on its own. */
+#ifndef MSTEST_WATCHDOG_GRACE_MS
+#define MSTEST_WATCHDOG_GRACE_MS 60000
+#endif
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Aborts the process when a test runs past the hang timeout, or far past
+ * its MSTEST_TIMEOUT budget, so a hanging test cannot stall the whole job. Runner
+ * threads attach a Watch for their lifetime and arm it around each test. */
+class Watchdog
+{
+public:
+    class Watch
+    {
+    public:
+        explicit Watch(Watchdog& watchdog);
+        ~Watch();
+
+        void arm(TestCaseNode& test);
+        void disarm();
+
+    private:
+        friend class Watchdog;
+
+        Watchdog& watchdog_;
+        std::atomic<std::int64_t> deadline_{0};
+        std::atomic<std::uint32_t> limit_ms_{0};
+        std::atomic<TestCaseNode*> test_{nullptr};
+    };
+
+    explicit Watchdog(std::uint32_t hang_timeout_ms);
+    ~Watchdog();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void monitor();
+    static std::int64_t now_ms();
+
+    const std::uint32_t hang_timeout_ms_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool stop_ = false;
+    std::vector<Watch*> watches_;
+    std::thread thread_;
+};
+
+/* Arms the watch attached to the calling thread, if any */
+void watchdog_arm(TestCaseNode& test);
+void watchdog_disarm();
+
+} // namespace detail
+} // namespace mstest
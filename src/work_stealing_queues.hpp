@@ -0,0 +1,97 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace mstest
+{
+namespace detail
+{
+
+/* Per-worker queues of task indexes. The owner takes tasks from the front
+ * (lowest index first, so results become printable in order), idle workers
+ * steal from the back of other queues. Tasks are only pushed before the
+ * workers start, so a worker may finish once every queue is empty. */
+class WorkStealingQueues
+{
+public:
+    explicit WorkStealingQueues(std::size_t workers)
+        : queues_(workers)
+    {
+    }
+
+    /* Deals tasks round-robin, worker N starts with tasks N, N + workers, ... */
+    void distribute(std::size_t tasks)
+    {
+        for (std::size_t task = 0; task < tasks; ++task)
+        {
+            queues_[task % queues_.size()].tasks.push_back(task);
+        }
+    }
+
+    std::optional<std::size_t> pop(std::size_t worker)
+    {
+        {
+            Queue& own = queues_[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                const std::size_t task = own.tasks.front();
+                own.tasks.pop_front();
+                return task;
+            }
+        }
+
+        for (std::size_t i = 1; i < queues_.size(); ++i)
+        {
+            Queue& victim = queues_[(worker + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                const std::size_t task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<Queue> queues_;
+};
+
+} // namespace detail
+} // namespace mstest
@@ -0,0 +1,297 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures what mstest itself costs on a generated suite and prints one
+ * JSON object, to stdout or to the file given with --output=FILE:
+ *
+ *   registration_ns_per_test  static registration at startup
+ *   dispatch_ns_per_test      run_tests() per test, silent reporter
+ *   expect_pass_ns            one passing expect_eq()
+ *   expect_fail_ns            one failing expect_eq(), recording included
+ *   mock_call_ns              one call of a mock::Function, arguments
+ *                             recorded
+ *   startup_ns_per_test       process start and exit, minus a binary
+ *                             without tests
+ *   text_bytes_per_test       executable code, same difference
+ *   image_bytes_per_test      all loaded sections, same difference
+ *
+ * Every figure is the median of several runs. */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include <elf.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "mstest/mstest.hpp"
+
+extern const std::uint64_t mstest_bench_registration_start;
+extern const std::uint64_t mstest_bench_registration_end;
+extern const std::size_t mstest_bench_tests;
+
+extern char** environ;
+
+namespace
+{
+
+using mstest::detail::Clock;
+
+constexpr std::size_t repeats = 15;
+constexpr std::size_t expect_iterations = 1000000;
+
+template <class Measure>
+double median_ns(Measure measure)
+{
+    std::vector<double> samples;
+    for (std::size_t i = 0; i < repeats; ++i)
+    {
+        samples.push_back(measure());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+class SilentReporter final : public mstest::Reporter
+{
+};
+
+double dispatch_ns_per_test()
+{
+    SilentReporter reporter;
+    mstest::Options options;
+    options.reporter = &reporter;
+    options.slowest = 0;
+    return median_ns([&options] {
+        const std::uint64_t start = Clock::now();
+        mstest::run_tests(options);
+        return static_cast<double>(Clock::to_ns(Clock::now() - start)) / static_cast<double>(mstest_bench_tests);
+    });
+}
+
+/* Test the measured expectations report to */
+class Probe final : public mstest::Test
+{
+    void execute() override
+    {
+    }
+};
+
+double expect_ns(bool passing)
+{
+    Probe probe;
+    mstest::detail::Context& context = mstest::detail::Context::get();
+    context.current_test(&probe);
+    const double ns = median_ns([&context, passing] {
+        const std::uint64_t start = Clock::now();
+        for (std::size_t i = 0; i < expect_iterations; ++i)
+        {
+            int a = static_cast<int>(i);
+            int b = passing ? a : a + 1;
+            mstest::do_not_optimize(a);
+            mstest::do_not_optimize(b);
+            mstest::expect_eq(a, b);
+            /* Every failure takes the full recording path */
+            context.failures().clear();
+        }
+        return static_cast<double>(Clock::to_ns(Clock::now() - start)) / static_cast<double>(expect_iterations);
+    });
+    context.current_test(nullptr);
+    context.reset();
+    return ns;
+}
+
+double mock_call_ns()
+{
+    mstest::mock::Function<int(int, int)> mock;
+    mock.returns(1);
+    return median_ns([&mock] {
+        const std::uint64_t start = Clock::now();
+        for (std::size_t i = 0; i < expect_iterations; ++i)
+        {
+            int a = static_cast<int>(i);
+            mstest::do_not_optimize(a);
+            int result = mock(a, a);
+            mstest::do_not_optimize(result);
+            /* Every call takes the recording path */
+            if (mock.recorded() == MSTEST_MOCK_CAPACITY)
+            {
+                mock.clear();
+            }
+        }
+        return static_cast<double>(Clock::to_ns(Clock::now() - start)) / static_cast<double>(expect_iterations);
+    });
+}
+
+double startup_ns(const char* path)
+{
+    return median_ns([path] {
+        char* const argv[] = {const_cast<char*>(path), nullptr};
+        const std::uint64_t start = Clock::now();
+        pid_t pid;
+        if (posix_spawn(&pid, path, nullptr, nullptr, argv, environ) != 0)
+        {
+            return 0.0;
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        return static_cast<double>(Clock::to_ns(Clock::now() - start));
+    });
+}
+
+struct ImageSize
+{
+    std::uint64_t text = 0;
+    std::uint64_t image = 0;
+};
+
+/* Sums loaded sections of a 64-bit ELF file, zero for anything else */
+ImageSize image_size(const char* path)
+{
+    ImageSize size;
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return size;
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[65536];
+    std::size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) != 0)
+    {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    Elf64_Ehdr header;
+    if (data.size() < sizeof(header))
+    {
+        return size;
+    }
+    std::copy_n(data.data(), sizeof(header), reinterpret_cast<unsigned char*>(&header));
+    if (std::string_view(reinterpret_cast<const char*>(header.e_ident), SELFMAG) != ELFMAG || header.e_ident[EI_CLASS] != ELFCLASS64
+        || header.e_shoff + static_cast<std::uint64_t>(header.e_shnum) * sizeof(Elf64_Shdr) > data.size())
+    {
+        return size;
+    }
+    for (std::size_t i = 0; i < header.e_shnum; ++i)
+    {
+        Elf64_Shdr section;
+        std::copy_n(data.data() + header.e_shoff + i * sizeof(section), sizeof(section), reinterpret_cast<unsigned char*>(&section));
+        if ((section.sh_flags & SHF_ALLOC) == 0 || section.sh_type == SHT_NOBITS)
+        {
+            continue;
+        }
+        size.image += section.sh_size;
+        if ((section.sh_flags & SHF_EXECINSTR) != 0)
+        {
+            size.text += section.sh_size;
+        }
+    }
+    return size;
+}
+
+double per_test(double with_tests, double without_tests)
+{
+    return (with_tests - without_tests) / static_cast<double>(mstest_bench_tests);
+}
+
+template <class Flag>
+const char* boolean(Flag flag)
+{
+    return flag ? "true" : "false";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* output_path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        if (arg.substr(0, 9) == "--output=")
+        {
+            output_path = argv[i] + 9;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--output=FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const double registration = static_cast<double>(Clock::to_ns(mstest_bench_registration_end - mstest_bench_registration_start))
+        / static_cast<double>(mstest_bench_tests);
+    const double dispatch = dispatch_ns_per_test();
+    const double expect_pass = expect_ns(true);
+    const double expect_fail = expect_ns(false);
+    const double mock_call = mock_call_ns();
+    const double startup = startup_ns(MSTEST_BENCH_STARTUP);
+    const double baseline_startup = startup_ns(MSTEST_BENCH_BASELINE);
+    const ImageSize size = image_size(MSTEST_BENCH_STARTUP);
+    const ImageSize baseline_size = image_size(MSTEST_BENCH_BASELINE);
+
+    FILE* output = output_path != nullptr ? fopen(output_path, "w") : stdout;
+    if (output == nullptr)
+    {
+        perror("mstest_bench: unable to open output");
+        return 1;
+    }
+
+    fprintf(output, "{\"tests\":%zu", mstest_bench_tests);
+#if defined(MSTEST_SECTION_REGISTRY)
+    fprintf(output, ",\"section_registry\":%s", boolean(true));
+#else
+    fprintf(output, ",\"section_registry\":%s", boolean(false));
+#endif
+#if defined(MSTEST_COMPACT_EXPECTATIONS)
+    fprintf(output, ",\"compact_expectations\":%s", boolean(true));
+#else
+    fprintf(output, ",\"compact_expectations\":%s", boolean(false));
+#endif
+#if defined(MSTEST_ALLOCATION_TRACKING)
+    fprintf(output, ",\"allocation_tracking\":%s", boolean(true));
+#else
+    fprintf(output, ",\"allocation_tracking\":%s", boolean(false));
+#endif
+    fprintf(output, ",\"registration_ns_per_test\":%.2f,\"dispatch_ns_per_test\":%.2f", registration, dispatch);
+    fprintf(output, ",\"expect_pass_ns\":%.3f,\"expect_fail_ns\":%.3f", expect_pass, expect_fail);
+    fprintf(output, ",\"mock_call_ns\":%.3f", mock_call);
+    fprintf(output, ",\"startup_ns\":%.0f,\"baseline_startup_ns\":%.0f,\"startup_ns_per_test\":%.2f", startup, baseline_startup,
+        per_test(startup, baseline_startup));
+    fprintf(output, ",\"text_bytes_per_test\":%.1f,\"image_bytes_per_test\":%.1f}\n",
+        per_test(static_cast<double>(size.text), static_cast<double>(baseline_size.text)),
+        per_test(static_cast<double>(size.image), static_cast<double>(baseline_size.image)));
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,669 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Turns frames written by --format=binary back into the console report:
+ *
+ *   ./tests --format=binary | mstest_decode --strings=tests.strings
+ *
+ * String tables come from mstest_add_string_table(), names missing from
+ * them are printed as hashes. Bytes before the stream start, e.g. boot
+ * messages of a target, are passed through unchanged. */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mstest/detail/binary_protocol.hpp"
+#include "mstest/detail/hash.hpp"
+#include "mstest/options.hpp"
+#include "mstest/reporter.hpp"
+
+#include "runner_internal.hpp"
+
+namespace mstest
+{
+namespace detail
+{
+namespace
+{
+
+template <class T>
+void print_pointer(const void* data, char* buffer, std::size_t size)
+{
+    T value;
+    memcpy(&value, data, sizeof(value));
+    snprintf(buffer, size, "0x%0*llX", static_cast<int>(sizeof(T) * 2), static_cast<unsigned long long>(value));
+}
+
+/* Printer of a raw operand sent by the target, nullptr when the host has
+ * no type of that size */
+PrintFunction raw_printer(OperandType type, std::size_t size)
+{
+    switch (type)
+    {
+        case OperandType::boolean:
+            return size == sizeof(bool) ? &print_stored<bool> : nullptr;
+        case OperandType::signed_integer:
+            switch (size)
+            {
+                case 1: return &print_stored<std::int8_t>;
+                case 2: return &print_stored<std::int16_t>;
+                case 4: return &print_stored<std::int32_t>;
+                case 8: return &print_stored<std::int64_t>;
+            }
+            return nullptr;
+        case OperandType::unsigned_integer:
+            switch (size)
+            {
+                case 1: return &print_stored<std::uint8_t>;
+                case 2: return &print_stored<std::uint16_t>;
+                case 4: return &print_stored<std::uint32_t>;
+                case 8: return &print_stored<std::uint64_t>;
+            }
+            return nullptr;
+        case OperandType::floating:
+            switch (size)
+            {
+                case sizeof(float): return &print_stored<float>;
+                case sizeof(double): return &print_stored<double>;
+                case sizeof(long double): return &print_stored<long double>;
+            }
+            return nullptr;
+        case OperandType::pointer:
+            switch (size)
+            {
+                case 2: return &print_pointer<std::uint16_t>;
+                case 4: return &print_pointer<std::uint32_t>;
+                case 8: return &print_pointer<std::uint64_t>;
+            }
+            return nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+class Decoder
+{
+public:
+    explicit Decoder(const Options& options)
+        : report_(options)
+    {
+    }
+
+    bool load_strings(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+            if (kind == "test")
+            {
+                std::string suite;
+                std::string testcase;
+                fields >> suite >> testcase;
+                names_[test_id(suite.c_str(), testcase.c_str())] = {suite, testcase};
+            }
+            else if (kind == "file")
+            {
+                std::string name;
+                std::getline(fields >> std::ws, name);
+                files_[fnv1a(name.c_str())] = name;
+            }
+        }
+        return true;
+    }
+
+    /* Decodes the whole stream, returns number of failed tests or -1 when
+     * the stream is corrupt, ended before the summary or the summary does
+     * not match the results decoded */
+    int decode(FILE* input)
+    {
+        if (!find_start(input))
+        {
+            fprintf(stderr, "mstest_decode: no test results in the input\n");
+            return -1;
+        }
+
+        int type;
+        std::vector<std::uint8_t> payload;
+        while ((type = fgetc(input)) != EOF)
+        {
+            /* A frame out of step, e.g. after text a test printed into the
+             * stream, would make all that follows garbage */
+            std::uint64_t size;
+            if (!read_varint(input, size))
+            {
+                break;
+            }
+            if (size > max_frame_size)
+            {
+                fprintf(stderr, "mstest_decode: corrupt stream, frame of type %d claims %llu bytes\n", type,
+                    static_cast<unsigned long long>(size));
+                report_summary(report_);
+                return -1;
+            }
+            payload.resize(size);
+            if (size != 0 && fread(payload.data(), 1, size, input) != size)
+            {
+                break;
+            }
+            const std::uint8_t* in = payload.data();
+            if (!frame(static_cast<binary::Frame>(type), in, in + payload.size()))
+            {
+                fprintf(stderr, "mstest_decode: corrupt stream, unknown or malformed frame of type %d\n", type);
+                report_summary(report_);
+                return -1;
+            }
+            if (finished_)
+            {
+                const int failed = report_summary(report_);
+                if (report_.summary.executed != expected_executed_ || report_.summary.passed != expected_passed_)
+                {
+                    fprintf(stderr, "mstest_decode: the target reported %d executed and %d passed tests, %d and %d were decoded\n",
+                        expected_executed_, expected_passed_, report_.summary.executed, report_.summary.passed);
+                    return -1;
+                }
+                return failed;
+            }
+        }
+
+        fprintf(stderr, "mstest_decode: stream ended before the summary\n");
+        report_summary(report_);
+        return -1;
+    }
+
+private:
+    /* Copies everything before the magic bytes to stdout */
+    static bool find_start(FILE* input)
+    {
+        std::size_t matched = 0;
+        int c;
+        while ((c = fgetc(input)) != EOF)
+        {
+            if (c == binary::magic[matched])
+            {
+                if (++matched == sizeof(binary::magic))
+                {
+                    return true;
+                }
+                continue;
+            }
+            fwrite(binary::magic, 1, matched, stdout);
+            matched = 0;
+            if (c == binary::magic[0])
+            {
+                matched = 1;
+                continue;
+            }
+            fputc(c, stdout);
+        }
+        return false;
+    }
+
+    static bool read_varint(FILE* input, std::uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            const int byte = fgetc(input);
+            if (byte == EOF)
+            {
+                return false;
+            }
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool frame(binary::Frame type, const std::uint8_t*& in, const std::uint8_t* end)
+    {
+        std::uint64_t values[7];
+        auto read = [&](std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (!binary::get_varint(in, end, values[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        switch (type)
+        {
+            case binary::Frame::start:
+                if (!read(1))
+                {
+                    return false;
+                }
+                report_start(report_, values[0]);
+                return true;
+            case binary::Frame::suite:
+                /* report_test() starts suites as they change */
+                return true;
+            case binary::Frame::failure:
+                return failure(in, end);
+            case binary::Frame::dropped:
+                if (!read(2))
+                {
+                    return false;
+                }
+                record_.failures.dropped(values[1]);
+                return true;
+            case binary::Frame::benchmark:
+            {
+                if (!read(7))
+                {
+                    return false;
+                }
+                BenchmarkStats stats;
+                stats.iterations = values[1];
+                stats.samples = static_cast<std::uint32_t>(values[2]);
+                stats.min_ns = static_cast<double>(values[3]) / 1000;
+                stats.median_ns = static_cast<double>(values[4]) / 1000;
+                stats.p99_ns = static_cast<double>(values[5]) / 1000;
+                stats.mean_ns = static_cast<double>(values[6]) / 1000;
+                record_.benchmark = stats;
+                return true;
+            }
+            case binary::Frame::property:
+            {
+                if (!read(6))
+                {
+                    return false;
+                }
+                PropertyStats& property = record_.property;
+                property.seed = values[1];
+                property.cases = static_cast<std::uint32_t>(values[2]);
+                property.shrinks = static_cast<std::uint32_t>(values[3]);
+                property.duration_ns = values[4];
+                property.falsified = values[5] != 0;
+                snprintf(property.example, sizeof(property.example), "%.*s", static_cast<int>(end - in), reinterpret_cast<const char*>(in));
+                return true;
+            }
+            case binary::Frame::repeat:
+            {
+                if (!read(6))
+                {
+                    return false;
+                }
+                RepeatStats& repeat = record_.repeat;
+                repeat.runs = static_cast<std::uint32_t>(values[1]);
+                repeat.failures = static_cast<std::uint32_t>(values[2]);
+                repeat.p50_ns = values[3];
+                repeat.p99_ns = values[4];
+                repeat.max_ns = values[5];
+                return true;
+            }
+            case binary::Frame::note:
+            {
+                if (!read(1))
+                {
+                    return false;
+                }
+                const std::uint8_t* title_end = static_cast<const std::uint8_t*>(memchr(in, '\0', static_cast<std::size_t>(end - in)));
+                if (title_end == nullptr)
+                {
+                    return false;
+                }
+                note_title_.assign(reinterpret_cast<const char*>(in), reinterpret_cast<const char*>(title_end));
+                note_.assign(reinterpret_cast<const char*>(title_end + 1), reinterpret_cast<const char*>(end));
+                return true;
+            }
+            case binary::Frame::result:
+            {
+                if (!read(6))
+                {
+                    return false;
+                }
+                TestCaseNode& test = node(static_cast<std::uint32_t>(values[0]));
+                TestResult result;
+                result.passed = (values[1] & binary::passed) != 0;
+                result.timed_out = (values[1] & binary::timed_out) != 0;
+                result.budget_ms = static_cast<std::uint32_t>(values[2]);
+                result.setup_ns = values[3];
+                result.execute_ns = values[4];
+                result.teardown_ns = values[5];
+                std::uint64_t heap[5];
+                for (std::uint64_t& value : heap)
+                {
+                    /* Older streams end here */
+                    value = 0;
+                    binary::get_varint(in, end, value);
+                }
+                result.heap.allocations = static_cast<std::uint32_t>(heap[0]);
+                result.heap.frees = static_cast<std::uint32_t>(heap[1]);
+                result.heap.bytes = heap[2];
+                result.heap.peak_bytes = static_cast<std::int64_t>(heap[3]);
+                result.heap.live_bytes = static_cast<std::int64_t>(heap[4]);
+                std::uint64_t available = 0;
+                if (binary::get_varint(in, end, available))
+                {
+                    result.counters.available = static_cast<std::uint8_t>(available);
+                    for (std::uint64_t& count : result.counters.counts)
+                    {
+                        binary::get_varint(in, end, count);
+                    }
+                }
+                test.result(result);
+                report_test(test, record_, report_, note_title_.empty() ? nullptr : note_title_.c_str(), note_.c_str());
+                record_ = TestRecord{};
+                note_title_.clear();
+                note_.clear();
+                return true;
+            }
+            case binary::Frame::summary:
+                /* Executed and passed are counted from the results again,
+                 * the counts of the target tell whether results got lost */
+                if (!read(3))
+                {
+                    return false;
+                }
+                expected_executed_ = static_cast<int>(values[0]);
+                expected_passed_ = static_cast<int>(values[1]);
+                report_.summary.skipped = static_cast<int>(values[2]);
+                finished_ = true;
+                return true;
+        }
+        /* Not a frame, the stream is out of step */
+        return false;
+    }
+
+    bool failure(const std::uint8_t*& in, const std::uint8_t* end)
+    {
+        std::uint64_t test;
+        std::uint64_t file;
+        std::uint64_t line;
+        std::uint64_t kind;
+        std::uint64_t count;
+        if (!binary::get_varint(in, end, test) || !binary::get_varint(in, end, file) || !binary::get_varint(in, end, line)
+            || !binary::get_varint(in, end, kind) || !binary::get_varint(in, end, count)
+            || kind > static_cast<std::uint64_t>(Expectation::mock_call_missing) || count > 2)
+        {
+            return false;
+        }
+
+        FailureRecord failure{};
+        failure.file = file_name(static_cast<std::uint32_t>(file));
+        failure.line = static_cast<std::uint_least32_t>(line);
+        failure.kind = static_cast<Expectation>(kind);
+        failure.operand_count = static_cast<std::uint8_t>(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::uint64_t type;
+            std::uint64_t size;
+            if (!binary::get_varint(in, end, type) || !binary::get_varint(in, end, size) || size > static_cast<std::uint64_t>(end - in))
+            {
+                return false;
+            }
+
+            OperandRecord& operand = failure.operands[i];
+            operand.type = static_cast<OperandType>(type);
+            operand.print = raw_printer(operand.type, size);
+            if (operand.print != nullptr)
+            {
+                memcpy(operand.data, in, size);
+            }
+            else if (operand.type == OperandType::text)
+            {
+                const std::size_t length = size < sizeof(operand.data) ? size : sizeof(operand.data) - 1;
+                memcpy(operand.data, in, length);
+                operand.data[length] = '\0';
+                operand.print = &print_text;
+            }
+            else
+            {
+                snprintf(reinterpret_cast<char*>(operand.data), sizeof(operand.data), "<%u byte value>", static_cast<unsigned>(size));
+                operand.print = &print_text;
+            }
+            operand.size = static_cast<std::uint8_t>(size);
+            in += size;
+        }
+        record_.failures.push(failure);
+        return true;
+    }
+
+    TestCaseNode& node(std::uint32_t id)
+    {
+        auto found = nodes_.find(id);
+        if (found != nodes_.end())
+        {
+            return found->second;
+        }
+
+        auto name = names_.find(id);
+        if (name == names_.end())
+        {
+            char hash[16];
+            snprintf(hash, sizeof(hash), "0x%08X", static_cast<unsigned>(id));
+            name = names_.emplace(id, std::make_pair(std::string("<unknown>"), std::string(hash))).first;
+        }
+        return nodes_.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+            std::forward_as_tuple(name->second.first.c_str(), name->second.second.c_str())).first->second;
+    }
+
+    const char* file_name(std::uint32_t id)
+    {
+        auto found = files_.find(id);
+        if (found == files_.end())
+        {
+            char hash[16];
+            snprintf(hash, sizeof(hash), "0x%08X", static_cast<unsigned>(id));
+            found = files_.emplace(id, hash).first;
+        }
+        return found->second.c_str();
+    }
+
+    /* Largest payload taken as a frame, frames of a target are far
+     * smaller */
+    static constexpr std::uint64_t max_frame_size = 1 << 20;
+
+    Report report_;
+    bool finished_ = false;
+    /* Counts of the summary frame */
+    int expected_executed_ = 0;
+    int expected_passed_ = 0;
+    /* Frames of the test whose result frame comes next */
+    TestRecord record_{};
+    std::string note_title_;
+    std::string note_;
+    /* Element references stay valid when these grow */
+    std::unordered_map<std::uint32_t, std::pair<std::string, std::string>> names_;
+    std::unordered_map<std::uint32_t, std::string> files_;
+    std::unordered_map<std::uint32_t, TestCaseNode> nodes_;
+};
+
+void print_usage(FILE* out, const char* program)
+{
+    fprintf(out, "Usage: %s [options] [INPUT]\n", program);
+    fprintf(out, "Decodes results of --format=binary from INPUT or stdin.\n");
+    fprintf(out, "  --strings=FILE     string table of mstest_add_string_table(), may repeat\n");
+    fprintf(out, "  --format=FORMAT    console (default), junit or json (JSON Lines)\n");
+    fprintf(out, "  --no-color         console output without ANSI colors\n");
+    fprintf(out, "  --quiet            console output lists only failed tests\n");
+    fprintf(out, "  --slowest=N        list N slowest tests after the summary, 0 disables\n");
+    fprintf(out, "  --help             print this help and exit\n");
+}
+
+bool parse_flag(std::string_view arg, std::string_view flag, std::string_view& value)
+{
+    if (arg.substr(0, flag.size()) != flag)
+    {
+        return false;
+    }
+    value = arg.substr(flag.size());
+    return true;
+}
+
+bool parse_number(std::string_view value, std::size_t& number)
+{
+    if (value.empty())
+    {
+        return false;
+    }
+    number = 0;
+    for (const char c : value)
+    {
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        number = number * 10 + static_cast<std::size_t>(c - '0');
+    }
+    return true;
+}
+
+/* Only report options apply, run options of the runner are meaningless
+ * for a finished run */
+bool parse_arguments(int argc, char* argv[], Options& options, std::vector<const char*>& strings,
+    const char*& input_path)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        std::string_view value;
+        bool valid = true;
+
+        if (arg == "--no-color")
+        {
+            options.color = false;
+        }
+        else if (arg == "--quiet")
+        {
+            options.quiet = true;
+        }
+        else if (parse_flag(arg, "--strings=", value))
+        {
+            strings.push_back(value.data());
+            valid = !value.empty();
+        }
+        else if (parse_flag(arg, "--slowest=", value))
+        {
+            valid = parse_number(value, options.slowest);
+        }
+        else if (parse_flag(arg, "--format=", value))
+        {
+            if (value == "console")
+            {
+                options.format = Format::console;
+            }
+            else if (value == "junit")
+            {
+                options.format = Format::junit;
+            }
+            else if (value == "json")
+            {
+                options.format = Format::json;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (arg.substr(0, 1) != "-" && input_path == nullptr)
+        {
+            input_path = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            fprintf(stderr, "mstest_decode: unknown or malformed option: %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+} // namespace detail
+} // namespace mstest
+
+int main(int argc, char* argv[])
+{
+    using namespace mstest;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string_view(argv[i]) == "--help")
+        {
+            detail::print_usage(stdout, argv[0]);
+            return 0;
+        }
+    }
+
+    Options options;
+    std::vector<const char*> strings;
+    const char* input_path = nullptr;
+    if (!detail::parse_arguments(argc, argv, options, strings, input_path))
+    {
+        detail::print_usage(stderr, argv[0]);
+        return -1;
+    }
+
+    detail::Decoder decoder(options);
+    for (const char* path : strings)
+    {
+        if (!decoder.load_strings(path))
+        {
+            fprintf(stderr, "mstest_decode: unable to read %s\n", path);
+            return -1;
+        }
+    }
+
+    FILE* input = stdin;
+    if (input_path != nullptr && (input = fopen(input_path, "rb")) == nullptr)
+    {
+        fprintf(stderr, "mstest_decode: unable to open %s\n", input_path);
+        return -1;
+    }
+    const int failed = decoder.decode(input);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    return failed;
+}
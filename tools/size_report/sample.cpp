@@ -0,0 +1,86 @@
+/*
+ * MsTest C++ testing framework for embedded development(Cortex-M)
+ *
+ * Copyright 2020 Mateusz Stadnik
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Expectations the way target tests typically use them, compiled once per
+ * expectation mode by the mstest_size_report target. Never linked. */
+
+#include <cstdint>
+#include <string_view>
+
+#include "mstest/mstest.hpp"
+
+namespace
+{
+
+enum class State : std::uint8_t
+{
+    idle,
+    busy
+};
+
+volatile int sink;
+
+int read_int()
+{
+    return sink;
+}
+
+} // namespace
+
+#define MSTEST_SIZE_SAMPLE(n) \
+    MSTEST(Size, sample_##n) \
+    { \
+        const int value = read_int(); \
+        mstest::expect_eq(value, n); \
+        mstest::expect_lt(static_cast<unsigned>(value), n##u); \
+        mstest::expect_ge(static_cast<std::int64_t>(value), -n##ll); \
+        mstest::expect_eq(static_cast<float>(value), 0.5f * n); \
+        mstest::expect_true(value != n); \
+        mstest::expect_eq(value > n ? State::busy : State::idle, State::busy); \
+        mstest::expect_eq(std::string_view(value ? "on" : "off"), std::string_view("on")); \
+        mstest::expect_eq(static_cast<std::uint8_t>(value), std::uint8_t{n}); \
+        mstest::expect_eq(&sink, nullptr); \
+        mstest::expect_false(value == -n); \
+    }
+
+MSTEST_SIZE_SAMPLE(1)
+MSTEST_SIZE_SAMPLE(2)
+MSTEST_SIZE_SAMPLE(3)
+MSTEST_SIZE_SAMPLE(4)
+MSTEST_SIZE_SAMPLE(5)
+MSTEST_SIZE_SAMPLE(6)
+MSTEST_SIZE_SAMPLE(7)
+MSTEST_SIZE_SAMPLE(8)
+MSTEST_SIZE_SAMPLE(9)
+MSTEST_SIZE_SAMPLE(10)
+MSTEST_SIZE_SAMPLE(11)
+MSTEST_SIZE_SAMPLE(12)
+MSTEST_SIZE_SAMPLE(13)
+MSTEST_SIZE_SAMPLE(14)
+MSTEST_SIZE_SAMPLE(15)
+MSTEST_SIZE_SAMPLE(16)
+MSTEST_SIZE_SAMPLE(17)
+MSTEST_SIZE_SAMPLE(18)
+MSTEST_SIZE_SAMPLE(19)
+MSTEST_SIZE_SAMPLE(20)
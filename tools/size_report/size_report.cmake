@@ -0,0 +1,42 @@
+# Prints .text bytes of the sample tests in both expectation modes.
+# Arguments: SIZE_TOOL, FULL_OBJECTS, COMPACT_OBJECTS
+
+if (NOT SIZE_TOOL)
+    message(FATAL_ERROR "No size tool found, set MSTEST_SIZE_TOOL")
+endif ()
+
+# Sums .text and its subsections, such as .text.unlikely, of all objects
+function(mstest_text_size objects result)
+    set(total 0)
+    foreach (object ${objects})
+        execute_process(
+            COMMAND ${SIZE_TOOL} -A ${object}
+            OUTPUT_VARIABLE sections
+            RESULT_VARIABLE failed
+        )
+        if (failed)
+            message(FATAL_ERROR "${SIZE_TOOL} failed on ${object}")
+        endif ()
+        string(REGEX MATCHALL "\n\\.text[^ \n]*[ ]+[0-9]+" lines "${sections}")
+        foreach (line ${lines})
+            string(REGEX REPLACE ".*[ ]([0-9]+)$" "\\1" size "${line}")
+            math(EXPR total "${total} + ${size}")
+        endforeach ()
+    endforeach ()
+    set(${result} ${total} PARENT_SCOPE)
+endfunction ()
+
+mstest_text_size("${FULL_OBJECTS}" full)
+mstest_text_size("${COMPACT_OBJECTS}" compact)
+
+math(EXPR saved "${full} - ${compact}")
+if (full GREATER 0)
+    math(EXPR percent "${saved} * 100 / ${full}")
+else ()
+    set(percent 0)
+endif ()
+
+message("mstest .text of the sample tests")
+message("  full expectations:    ${full} bytes")
+message("  compact expectations: ${compact} bytes")
+message("  saved:                ${saved} bytes (${percent}%)")